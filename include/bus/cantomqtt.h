@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include <util/ixmlnode.h>
 
@@ -20,6 +21,12 @@
 #include <bus/interface/businterfacefactory.h>
 #include <bus/ibusmessagequeue.h>
 #include <bus/candataframe.h>
+#include <bus/compactdbc.h>
+#include <bus/configreader.h>
+#include <bus/eventcapture.h>
+#include <bus/lowlatency.h>
+#include <bus/mqttpublisher.h>
+#include <bus/topiclayout.h>
 
 namespace bus {
 
@@ -42,9 +49,22 @@ public:
 
   bool Start();
   void Stop();
+
+  /** \brief Returns the estimated memory used by the runtime model.
+   *
+   * Includes the compact DBC model, the selected metrics and the topic
+   * names. The figure is useful when sizing the gateway hardware.
+   */
+  [[nodiscard]] size_t MemoryUsage() const;
 private:
   std::string config_file_;
-  std::vector<dbc::DbcFile> dbc_files_;
+  std::vector<std::string> dbc_files_; ///< DBC file names.
+  SelectionIndex selection_;
+
+  /// Selected messages and signals. Replaces the full DBC model at runtime.
+  CompactDbc compact_dbc_;
+  /// No descriptions and DBC properties are stored in the metrics.
+  bool compact_metrics_ = true;
 
 
   std::string shared_mem_name_;
@@ -57,26 +77,62 @@ private:
   std::string broker_client_id_;
   std::string broker_user_;
   std::string broker_password_;
+  PublishQos publish_qos_ = PublishQos::AtLeastOnce;
+  size_t in_flight_window_ = 256;
+  size_t max_queue_size_ = 100'000;
+
+  TopicLayout topic_layout_ = TopicLayout::PerMessage;
+  std::string topic_prefix_ = "CanMetrics";
+  std::string topic_template_; ///< Only used by the custom layout.
+  uint16_t topic_alias_maximum_ = 0;
+  bool retain_ = false;
+
+  bool compression_ = false;
+  int compression_level_ = 3;
+  std::string dictionary_file_; ///< Trained zstd dictionary.
+
+  /** \brief Pre-calculated topic name for a signal. */
+  struct SignalTopic {
+    metric::Metric* metric = nullptr;
+    std::string topic;
+  };
+
+  /** \brief Pre-calculated topic names for a CAN message. */
+  struct GroupTopic {
+    const CompactMessage* message = nullptr;
+    bool per_signal = false;
+    std::string topic; ///< Topic if not per signal.
+    std::vector<SignalTopic> signal_list;
+  };
+  std::unordered_map<int64_t, GroupTopic> topic_list_;
+
+  LowLatencyConfig low_latency_;
+
+  /// Event triggered capture. Publishes to '<prefix>/Capture/<trigger>'.
+  EventCapture capture_;
+  size_t capture_buffer_size_ = 4096; ///< Samples per captured signal.
 
   metric::MetricDatabase metric_db_;
 
   std::unique_ptr<IBusMessageBroker> bus_broker_;
   std::shared_ptr<IBusMessageQueue> bus_subscriber_;
 
-  mqtt::MqttNode mqtt_node_;
+  MqttPublisher publisher_;
   std::thread work_thread_;
   std::atomic<bool> stop_thread_ = true;
 
   void SaveGeneral(util::xml::IXmlNode& root_node) const;
-  void ReadGeneral(const util::xml::IXmlNode& root_node);
+  void ReadGeneral(const ConfigReader& config);
   void SaveDbcFiles(util::xml::IXmlNode& root_node) const;
-  void ReadDbcFiles(const util::xml::IXmlNode& root_node);
   void SaveSelectedItems(util::xml::IXmlNode& root_node) const;
-  void ReadSelectedItems(const util::xml::IXmlNode& root_node);
-  bool ParseDbcFile(dbc::DbcFile& dbc_file) const;
+  void SaveTriggers(util::xml::IXmlNode& root_node) const;
+  void BuildRuntimeModel();
+  bool ParseDbcFile(dbc::DbcFile& dbc_file);
   void WorkingThread();
   bool UpdateMetrics(const CanDataFrame& can_msg);
-  bool StartMqtt();
+  void PublishMetrics(const CanDataFrame& can_msg);
+  bool StartPublisher();
+  void CreateTopics();
 };
 
 }  // namespace bus
@@ -0,0 +1,199 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace dbc {
+class Message;
+class Signal;
+}
+
+namespace bus {
+
+/** \brief Arena that stores interned (unique) strings.
+ *
+ * The strings are stored in large blocks, so each string doesn't need its
+ * own heap allocation. Equal strings are only stored once. The returned
+ * string views are valid as long as the arena exist.
+ */
+class StringArena {
+ public:
+  /** \brief Returns an interned copy of the text. */
+  [[nodiscard]] std::string_view Intern(std::string_view text);
+
+  /** \brief Releases the lookup index. No more strings can be interned. */
+  void ReleaseIndex();
+
+  void Clear();
+  [[nodiscard]] size_t MemoryUsage() const;
+
+ private:
+  static constexpr size_t kBlockSize = 16 * 1024;
+  std::vector<std::unique_ptr<char[]>> block_list_;
+  std::vector<size_t> block_size_list_;
+  size_t block_used_ = 0;
+  std::unordered_set<std::string_view> index_;
+};
+
+/** \brief Raw data type of a signal. */
+enum class RawDataType : uint8_t {
+  Unsigned = 0,
+  Signed,
+  Float,
+  Double
+};
+
+/** \brief Multiplexer role of a signal. */
+enum class RawMuxType : uint8_t {
+  NotMultiplexed = 0,
+  Multiplexor,
+  Multiplexed
+};
+
+/** \brief Enumerated values. Shared by all signals with the same values. */
+using EnumTable = std::vector<std::pair<int64_t, std::string_view>>;
+
+/** \brief Minimal signal definition that is needed to decode a signal. */
+struct CompactSignal {
+  std::string_view name;
+  std::string_view unit;
+  double scale = 1.0;
+  double offset = 0.0;
+  void* context = nullptr; ///< User reference, typical a metric.
+  int32_t enum_index = -1; ///< Index of the enum table. -1 = no enums.
+  int32_t mux_value = 0;   ///< Multiplexor value for multiplexed signals.
+  int32_t capture_index = -1; ///< Event capture signal. -1 = not captured.
+  uint16_t start_bit = 0;  ///< DBC start bit.
+  uint16_t bit_length = 0;
+  RawDataType data_type = RawDataType::Unsigned;
+  RawMuxType mux = RawMuxType::NotMultiplexed;
+  bool little_endian = true;
+};
+
+/** \brief Minimal CAN message definition with its selected signals. */
+struct CompactMessage {
+  uint64_t ident = 0;
+  std::string_view name;
+  std::string_view node;
+  void* context = nullptr;   ///< User reference, typical a metric group.
+  int32_t multiplexor = -1;  ///< Index of the multiplexor signal.
+  std::vector<CompactSignal> signal_list;
+};
+
+/** \brief Compact runtime representation of the selected DBC messages.
+ *
+ * The full DBC model uses a lot of memory for large OEM DBC files. At
+ * startup, only the selected messages and signals are copied into this
+ * class. The names are interned in a string arena and the enum tables
+ * are only stored once. The DBC model may then be released.
+ *
+ * The class also decodes the signal values from the CAN data bytes.
+ */
+class CompactDbc {
+ public:
+  [[nodiscard]] StringArena& Strings() { return strings_; }
+
+  /** \brief Adds an enum table or returns an identical existing table. */
+  [[nodiscard]] int32_t AddEnumTable(EnumTable enum_table);
+  [[nodiscard]] const EnumTable* GetEnumTable(int32_t index) const;
+
+  /** \brief Adds a message. Returns nullptr if it already exist.
+   *
+   * The message pointer and its signal pointers are stable.
+   */
+  CompactMessage* AddMessage(CompactMessage&& message);
+  [[nodiscard]] const CompactMessage* GetMessage(uint64_t ident) const;
+  [[nodiscard]] size_t NofMessages() const { return message_list_.size(); }
+  [[nodiscard]] size_t NofSignals() const;
+  /** \brief Number of signals with a context, i.e. selected signals. */
+  [[nodiscard]] size_t NofSelectedSignals() const;
+  [[nodiscard]] size_t NofEnumTables() const { return enum_list_.size(); }
+
+  /** \brief Releases build indexes and unused capacity. */
+  void Finalize();
+  void Clear();
+
+  /** \brief Estimated number of bytes used by the compact model. */
+  [[nodiscard]] size_t MemoryUsage() const;
+
+  /** \brief Returns true if the signal exist in the data bytes.
+   *
+   * A multiplexed signal only exist if the multiplexor has the signals
+   * multiplexor value.
+   */
+  [[nodiscard]] static bool IsValid(const CompactMessage& message,
+                                    const CompactSignal& signal,
+                                    std::span<const uint8_t> data);
+
+  /** \brief Returns the unscaled value. Max 64 bits. */
+  [[nodiscard]] static bool RawValue(const CompactSignal& signal,
+                                     std::span<const uint8_t> data,
+                                     uint64_t& value);
+
+  /** \brief Writes an unscaled value into the data bytes. Max 64 bits.
+   *
+   * The inverse of RawValue(). Used when generating CAN traffic.
+   */
+  static bool SetRawValue(const CompactSignal& signal,
+                          std::span<uint8_t> data, uint64_t value);
+
+  bool EngValue(const CompactMessage& message, const CompactSignal& signal,
+                std::span<const uint8_t> data, int64_t& value) const;
+  bool EngValue(const CompactMessage& message, const CompactSignal& signal,
+                std::span<const uint8_t> data, uint64_t& value) const;
+  bool EngValue(const CompactMessage& message, const CompactSignal& signal,
+                std::span<const uint8_t> data, double& value) const;
+  bool EngValue(const CompactMessage& message, const CompactSignal& signal,
+                std::span<const uint8_t> data, bool& value) const;
+  /** \brief Returns the enum text, a hex string for array values or the
+   * scaled value as text. */
+  bool EngValue(const CompactMessage& message, const CompactSignal& signal,
+                std::span<const uint8_t> data, std::string& value) const;
+
+ private:
+  StringArena strings_;
+  std::vector<EnumTable> enum_list_;
+  std::map<EnumTable, int32_t> enum_index_; ///< Only used while building.
+  std::deque<CompactMessage> message_list_;
+  std::unordered_map<uint64_t, CompactMessage*> message_index_;
+};
+
+/** \brief Creates a compact signal from a DBC signal.
+ *
+ * The names and enum table are added to the compact model. The
+ * signal isn't added to any message.
+ */
+[[nodiscard]] CompactSignal MakeCompactSignal(const dbc::Signal& signal,
+                                              CompactDbc& dbc);
+
+/** \brief Returns true if the message uses extended multiplexing. */
+[[nodiscard]] bool HasExtendedMux(const dbc::Message& message);
+
+/** \brief Returns false if the compact model can't decode the signal.
+ *
+ * Extended multiplexing (SG_MUL_VAL_) isn't supported. The multiplexed
+ * signals in such a message may depend on any multiplexor, so all of
+ * them are unsupported. The top multiplexor and the plain signals are
+ * still supported.
+ *
+ * @param signal DBC signal.
+ * @param extended_mux True if the message uses extended multiplexing.
+ */
+[[nodiscard]] bool IsSupportedSignal(const dbc::Signal& signal,
+                                     bool extended_mux);
+
+}  // namespace bus
@@ -0,0 +1,132 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <util/ixmlnode.h>
+
+#include <bus/eventcapture.h>
+#include <bus/selectionindex.h>
+
+namespace bus {
+
+/** \brief Streaming (expat) reader of the CAN to MQTT config file.
+ *
+ * The config file may hold many thousands of selected signals. Instead of
+ * building a DOM, the file is parsed as a stream. The general properties
+ * and DBC files are stored as plain values. The selected items are added
+ * directly to a hashed selection index.
+ *
+ * The selected items may be defined as explicit signals or as rules.
+ * ```
+ * <SelectedItems>
+ *   <Metric name='Speed' msg_id='256' msg_name='Vehicle'/>
+ *   <Rule min_id='0x100' max_id='0x1FF' node='ECU*' message='*' signal='*'/>
+ * </SelectedItems>
+ * ```
+ *
+ * Event triggers capture signal values before and after a condition.
+ * ```
+ * <Triggers>
+ *   <Trigger name='OverTemp' condition='BatteryTemp > 60 and Speed > 0'
+ *            pre='10' post='5' signals='BatteryTemp,Speed,Current'/>
+ * </Triggers>
+ * ```
+ *
+ * The class owns the schema of the sections above. The Write functions
+ * write them in the format that ParseFile() reads.
+ */
+class ConfigReader {
+ public:
+  bool ParseFile(const std::string& filename);
+
+  /** \brief Returns a general property value. */
+  template <typename T>
+  [[nodiscard]] T Property(const std::string& key, const T& def = {}) const;
+
+  [[nodiscard]] const std::vector<std::string>& DbcFiles() const {
+    return dbc_file_list_;
+  }
+
+  [[nodiscard]] SelectionIndex& Selection() { return selection_; }
+  [[nodiscard]] const SelectionIndex& Selection() const { return selection_; }
+
+  [[nodiscard]] const std::vector<TriggerConfig>& Triggers() const {
+    return trigger_list_;
+  }
+
+  [[nodiscard]] const std::string& LastError() const { return last_error_; }
+
+  static void WriteDbcFiles(util::xml::IXmlNode& root_node,
+                            const std::vector<std::string>& dbc_file_list);
+  /** \brief Adds the selected items section. */
+  static util::xml::IXmlNode& WriteSelectedItems(
+      util::xml::IXmlNode& root_node);
+  static void WriteRule(util::xml::IXmlNode& items_node,
+                        const SelectionRule& rule);
+  static void WriteMetric(util::xml::IXmlNode& items_node, uint64_t msg_id,
+                          const std::string& msg_name,
+                          const std::string& signal_name);
+  static void WriteTriggers(util::xml::IXmlNode& root_node,
+                            const std::vector<TriggerConfig>& trigger_list);
+
+  // Used by the expat callback functions.
+  void OnStartElement(const char* name, const char** attributes);
+  void OnEndElement(const char* name);
+  void OnCharacterData(const char* data, int length);
+
+ private:
+  enum class Section {
+    None,
+    General,
+    DbcFiles,
+    SelectedItems,
+    Triggers
+  };
+
+  std::unordered_map<std::string, std::string> property_list_;
+  std::vector<std::string> dbc_file_list_;
+  SelectionIndex selection_;
+  std::vector<TriggerConfig> trigger_list_;
+  std::string last_error_;
+
+  Section section_ = Section::None;
+  int level_ = 0;
+  std::string element_;
+  std::string text_;
+};
+
+template <typename T>
+T ConfigReader::Property(const std::string& key, const T& def) const {
+  const auto itr = property_list_.find(key);
+  if (itr == property_list_.cend() || itr->second.empty()) {
+    return def;
+  }
+  if constexpr (std::is_unsigned_v<T>) {
+    // The stream wraps a negative value into a huge unsigned value.
+    if (const size_t pos = itr->second.find_first_not_of(" \t\r\n");
+        pos != std::string::npos && itr->second[pos] == '-') {
+      return def;
+    }
+  }
+  T value = def;
+  std::istringstream temp(itr->second);
+  temp >> value;
+  return temp.fail() ? def : value;
+}
+
+template <>
+std::string ConfigReader::Property(const std::string& key,
+                                   const std::string& def) const;
+template <>
+bool ConfigReader::Property(const std::string& key, const bool& def) const;
+
+}  // namespace bus
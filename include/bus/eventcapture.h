@@ -0,0 +1,150 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <bus/signalringbuffer.h>
+#include <bus/triggerexpression.h>
+
+namespace bus {
+
+/** \brief Configuration of an event trigger. */
+struct TriggerConfig {
+  std::string name;
+  std::string condition;   ///< Trigger expression.
+  double pre_time = 10.0;  ///< Captured time before the trigger (s).
+  double post_time = 10.0; ///< Captured time after the trigger (s).
+  /// Captured signals. Empty list = the signals in the condition.
+  std::vector<std::string> signal_list;
+};
+
+/** \brief Event triggered capture of signal values.
+ *
+ * The captured signals are stored in lock-free ring buffers by the decode
+ * thread. A trigger condition is only evaluated when one of its signals
+ * changes value. When the condition becomes true, the capture waits for
+ * the post-trigger time and then publishes a burst with the samples
+ * between the pre-trigger and post-trigger time. The burst is built and
+ * published by a separate capture thread.
+ *
+ * The times are based on the CAN frame timestamps. If no frames are
+ * received, the capture thread completes the capture when the post-trigger
+ * time has passed on the system clock. The pending captures are published
+ * when the capture stops.
+ */
+class EventCapture {
+ public:
+  /** \brief Publishes a burst. The payload is a JSON object. */
+  using PublishFunction = std::function<void(const std::string& trigger,
+                                             std::string payload)>;
+
+  EventCapture() = default;
+  virtual ~EventCapture();
+
+  /** \brief Number of samples that are stored for each signal. */
+  void BufferSize(size_t nof_samples) { buffer_size_ = nof_samples; }
+  [[nodiscard]] size_t BufferSize() const { return buffer_size_; }
+
+  /** \brief Compiles and adds a trigger. */
+  bool AddTrigger(const TriggerConfig& config);
+  [[nodiscard]] std::vector<TriggerConfig> Triggers() const;
+  [[nodiscard]] bool IsEmpty() const { return trigger_list_.empty(); }
+  void Clear();
+
+  /** \brief Returns the capture index of a DBC signal or -1.
+   *
+   * Called when the runtime model is built. A signal name may be plain
+   * or qualified with the message name. A name is only bound to the first
+   * matching DBC signal.
+   */
+  int32_t BindSignal(std::string_view message_name,
+                     std::string_view signal_name);
+  void ResetBindings();
+  /** \brief Returns signal names without a DBC signal. */
+  [[nodiscard]] std::vector<std::string> UnboundSignals() const;
+
+  bool Start(PublishFunction publish);
+  void Stop();
+
+  /** \brief New signal value. Only called by the decode thread. */
+  void OnValue(int32_t index, uint64_t timestamp, double value);
+  /** \brief Evaluates the changed triggers. Only called by the decode
+   * thread after the signal values of a CAN frame have been updated. */
+  void Evaluate(uint64_t timestamp);
+
+  [[nodiscard]] uint64_t NofTriggered() const { return nof_triggered_; }
+  [[nodiscard]] uint64_t NofPublished() const { return nof_published_; }
+
+ private:
+  struct CaptureSignal {
+    std::string name;
+    bool bound = false;
+    std::unique_ptr<SignalRingBuffer> buffer;
+    std::vector<size_t> trigger_list; ///< Triggers that use the signal.
+  };
+
+  struct Trigger {
+    TriggerConfig config;
+    TriggerExpression expression;
+    std::vector<int32_t> capture_list; ///< Captured signal indexes.
+    bool dirty = false;
+    bool active = false;
+  };
+
+  struct Capture {
+    size_t trigger = 0;
+    uint64_t trigger_time = 0;
+    uint64_t start_time = 0;
+    uint64_t end_time = 0;
+    /// Completes the capture if no frames are received.
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  size_t buffer_size_ = 4096;
+  std::vector<CaptureSignal> signal_list_;
+  std::unordered_map<std::string, int32_t> signal_index_;
+  std::vector<Trigger> trigger_list_;
+
+  // Only used by the decode thread.
+  std::vector<double> value_list_;
+  std::vector<uint8_t> valid_list_;
+  std::vector<size_t> dirty_list_;
+
+  std::mutex capture_mutex_;
+  std::condition_variable capture_condition_;
+  std::vector<Capture> pending_list_; ///< Waits for post-trigger samples.
+  std::atomic<size_t> nof_pending_ = 0;
+  std::deque<Capture> capture_queue_;
+  std::thread capture_thread_;
+  std::atomic<bool> stop_thread_ = true;
+  PublishFunction publish_;
+
+  std::atomic<uint64_t> nof_triggered_ = 0;
+  std::atomic<uint64_t> nof_published_ = 0;
+
+  int32_t AddSignalName(std::string_view name);
+  void StartCapture(size_t trigger_index, uint64_t timestamp);
+  /** \brief Moves the completed captures to the queue. Needs the lock. */
+  bool CompleteCaptures(uint64_t timestamp,
+                        std::chrono::steady_clock::time_point now);
+  void CaptureThread();
+  [[nodiscard]] std::string MakePayload(const Capture& capture) const;
+};
+
+}  // namespace bus
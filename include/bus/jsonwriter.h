@@ -0,0 +1,31 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace bus {
+
+/** \brief Appends a quoted JSON string.
+ *
+ * Quotes, backslashes and control characters are escaped, so any DBC or
+ * config text gives a valid JSON string.
+ */
+void AddJsonString(std::string& json, std::string_view text);
+void AddJsonString(std::ostream& json, std::string_view text);
+
+/** \brief Appends a JSON number. Infinite and NaN values are null.
+ *
+ * A double uses the shortest text that reads back to the same value.
+ */
+void AddJsonNumber(std::string& json, double value);
+void AddJsonNumber(std::string& json, uint64_t value);
+void AddJsonNumber(std::ostream& json, double value);
+
+}  // namespace bus
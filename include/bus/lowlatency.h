@@ -0,0 +1,64 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace bus {
+
+class ConfigReader;
+
+/** \brief Low-latency settings for the CAN receive and decode thread.
+ *
+ * A sleeping thread wakes up when the scheduler decides, which adds
+ * jitter. In low-latency mode the thread may be pinned to a CPU core,
+ * busy-poll the bus, run with a real-time priority and lock its memory,
+ * so no page faults occur while running.
+ */
+struct LowLatencyConfig {
+  bool enabled = false;
+  int cpu_core = -1;          ///< CPU core to pin to. -1 = no pinning.
+  bool busy_poll = false;     ///< Poll the bus instead of waiting.
+  int realtime_priority = 0;  ///< SCHED_FIFO priority (1-99). 0 = off.
+  bool lock_memory = false;   ///< Lock and pre-fault the memory.
+};
+
+/** \brief Reads the low-latency settings from the configuration file.
+ *
+ * Out of range values are limited. The real-time priority is limited to
+ * 0-99 and a negative CPU core means no pinning.
+ */
+[[nodiscard]] LowLatencyConfig ReadLowLatencyConfig(
+    const ConfigReader& config);
+
+/** \brief Applies the low-latency settings onto the calling thread.
+ *
+ * Errors are logged but are not fatal. The thread continues to run with
+ * whatever settings that succeeded. Note that real-time priority and
+ * memory locking requires privileges (CAP_SYS_NICE and CAP_IPC_LOCK).
+ *
+ * @param config Low-latency settings.
+ * @return True if all settings were applied.
+ */
+bool ApplyLowLatency(const LowLatencyConfig& config);
+
+/** \brief Short CPU friendly pause used by busy-polling loops.
+ *
+ * The first empty polls only spin, then the thread yields and at last it
+ * sleeps. The sleep grows up to 1 ms. A yield doesn't give the CPU to
+ * lower priority threads when running with SCHED_FIFO, so only the sleep
+ * stops an idle bus from starving other threads on the core.
+ *
+ * @param nof_empty_polls Number of polls in a row that were empty.
+ */
+void BusyPollBackoff(uint32_t nof_empty_polls);
+
+/** \brief Returns the sleep time of a backoff. 0 = no sleep. */
+[[nodiscard]] std::chrono::microseconds BusyPollSleepTime(
+    uint32_t nof_empty_polls);
+
+}  // namespace bus
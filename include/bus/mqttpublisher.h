@@ -0,0 +1,226 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <metric/metricdatabase.h>
+
+#include <bus/payloadcompressor.h>
+
+namespace bus {
+
+/** \brief MQTT quality of service used when publishing. */
+enum class PublishQos : uint8_t {
+  AtMostOnce = 0,  ///< QoS 0. Fire and forget.
+  AtLeastOnce = 1, ///< QoS 1. Acknowledged by a PUBACK.
+  ExactlyOnce = 2  ///< QoS 2. Acknowledged by a PUBREC/PUBCOMP sequence.
+};
+
+/** \brief Outbound MQTT message. */
+struct PublishMessage {
+  std::string topic;
+  std::string payload;
+  std::string content_type; ///< MIME type of the uncompressed payload.
+  bool retain = false;
+};
+
+/** \brief Topic aliases of a MQTT 5 network connection.
+ *
+ * The first publish on a topic sends the topic name and a new alias. The
+ * topic name is sent until the broker has acknowledged a publish that
+ * defines the alias. After that, only the alias is sent. The broker
+ * forgets the aliases when the connection is lost, so the table must be
+ * reset on every (re)connect.
+ */
+class TopicAliasTable {
+ public:
+  /** \brief Returns the alias of a topic or 0 if no alias is free.
+   *
+   * @param topic Topic name.
+   * @param max_aliases Max number of aliases in the connection.
+   * @param send_topic True if the topic name must be sent.
+   * @return Alias (1..max_aliases) or 0.
+   */
+  uint16_t Assign(const std::string& topic, size_t max_aliases,
+                  bool& send_topic);
+  /** \brief The broker has acknowledged the topic name of the alias. */
+  void Confirm(uint16_t alias);
+  void Reset() {
+    alias_list_.clear();
+    confirmed_list_.clear();
+  }
+  [[nodiscard]] size_t Size() const { return alias_list_.size(); }
+
+ private:
+  std::unordered_map<std::string, uint16_t> alias_list_;
+  std::vector<uint8_t> confirmed_list_; ///< Indexed by alias - 1.
+};
+
+/** \brief Asynchronous and pipelined MQTT 5 publisher.
+ *
+ * The publisher owns a Boost MQTT 5 client that runs on its own io_context
+ * thread. The caller (the CAN decode thread) only appends messages to a
+ * queue and never waits for the broker. The io thread keeps up to
+ * InFlightWindow() messages outstanding at the same time. The MQTT client
+ * coalesces all packets that are queued in the same io_context turn into
+ * a single socket write, so a burst of messages is sent as one write.
+ *
+ * Completion is tracked by counters that may be read from any thread.
+ */
+class MqttPublisher {
+ public:
+  MqttPublisher();
+  virtual ~MqttPublisher();
+
+  MqttPublisher(const MqttPublisher&) = delete;
+  MqttPublisher& operator=(const MqttPublisher&) = delete;
+
+  void Host(std::string host) { host_ = std::move(host); }
+  [[nodiscard]] const std::string& Host() const { return host_; }
+
+  void Port(uint16_t port) { port_ = port; }
+  [[nodiscard]] uint16_t Port() const { return port_; }
+
+  void ClientId(std::string client_id) { client_id_ = std::move(client_id); }
+  [[nodiscard]] const std::string& ClientId() const { return client_id_; }
+
+  void UserName(std::string user) { user_ = std::move(user); }
+  [[nodiscard]] const std::string& UserName() const { return user_; }
+
+  void Password(std::string password) { password_ = std::move(password); }
+  [[nodiscard]] const std::string& Password() const { return password_; }
+
+  /** \brief Transport layer. Only plain TCP is supported. */
+  void Transport(metric::TransportLayer transport) { transport_ = transport; }
+  [[nodiscard]] metric::TransportLayer Transport() const {
+    return transport_;
+  }
+
+  void Qos(PublishQos qos) { qos_ = qos; }
+  [[nodiscard]] PublishQos Qos() const { return qos_; }
+
+  /** \brief Maximum number of unacknowledged messages on the link.
+   *
+   * High-latency links (cellular) need many messages in flight to reach
+   * a usable throughput. The broker's Receive Maximum may further limit
+   * the window. A window of 0 is set to 1.
+   */
+  void InFlightWindow(size_t window);
+  [[nodiscard]] size_t InFlightWindow() const { return in_flight_window_; }
+
+  /** \brief Maximum number of messages waiting to be sent.
+   *
+   * Messages are dropped if the queue is full. This protects the memory
+   * if the broker link is down for a long time.
+   */
+  void MaxQueueSize(size_t max_size) { max_queue_size_ = max_size; }
+  [[nodiscard]] size_t MaxQueueSize() const { return max_queue_size_; }
+
+  /** \brief Maximum number of MQTT 5 topic aliases used in a session.
+   *
+   * The first publish on a topic sends the topic name and an alias. The
+   * following publishes only sends the alias (2 bytes). The broker's
+   * Topic Alias Maximum limits the number of aliases. Set to 0 to disable.
+   */
+  void TopicAliasMaximum(uint16_t max_aliases) {
+    topic_alias_maximum_ = max_aliases;
+  }
+  [[nodiscard]] uint16_t TopicAliasMaximum() const {
+    return topic_alias_maximum_;
+  }
+
+  /** \brief Enables zstd compression of the payloads.
+   *
+   * The payloads are compressed on the publish thread. A compressed
+   * payload has the content type 'application/zstd'. The user properties
+   * 'zstd-dictionary' and 'content-type' holds the dictionary ID and the
+   * original content type. Payloads that doesn't get smaller are sent
+   * uncompressed.
+   */
+  void Compression(bool compression) { compression_ = compression; }
+  [[nodiscard]] bool Compression() const { return compression_; }
+
+  [[nodiscard]] PayloadCompressor& Compressor() { return compressor_; }
+  [[nodiscard]] const PayloadCompressor& Compressor() const {
+    return compressor_;
+  }
+
+  bool Start();
+  void Stop();
+  [[nodiscard]] bool IsStarted() const { return started_; }
+
+  /** \brief Queues a message for publishing. Never blocks.
+   *
+   * @param message Message to publish.
+   * @return False if the publisher isn't started or the queue is full.
+   */
+  bool Publish(PublishMessage message);
+
+  [[nodiscard]] uint64_t NofPublished() const { return nof_published_; }
+  [[nodiscard]] uint64_t NofCompleted() const { return nof_completed_; }
+  [[nodiscard]] uint64_t NofFailed() const { return nof_failed_; }
+  [[nodiscard]] uint64_t NofDropped() const { return nof_dropped_; }
+  [[nodiscard]] size_t InFlight() const { return in_flight_; }
+  /** \brief Number of established (CONNACK) connections. */
+  [[nodiscard]] uint64_t NofConnects() const { return nof_connects_; }
+  [[nodiscard]] bool IsConnected() const { return connected_; }
+  [[nodiscard]] size_t QueueSize() const;
+
+ private:
+  struct Context;
+
+  std::string host_ = "127.0.0.1";
+  uint16_t port_ = 1883;
+  std::string client_id_;
+  std::string user_;
+  std::string password_;
+  metric::TransportLayer transport_ = metric::TransportLayer::MqttTcp;
+  PublishQos qos_ = PublishQos::AtLeastOnce;
+  size_t in_flight_window_ = 256;
+  size_t max_queue_size_ = 100'000;
+  uint16_t topic_alias_maximum_ = 0;
+  bool compression_ = false;
+  PayloadCompressor compressor_; ///< Only used by the io thread.
+
+  std::unique_ptr<Context> context_;
+  std::thread io_thread_;
+  std::atomic<bool> started_ = false;
+
+  mutable std::mutex queue_locker_;
+  std::deque<PublishMessage> queue_;
+  std::atomic<bool> drain_posted_ = false;
+
+  /// Topic aliases. Only used by the io thread.
+  TopicAliasTable topic_aliases_;
+  /// Number of CONNACK received. Updated by the client on the io thread.
+  std::atomic<uint64_t> nof_connects_ = 0;
+  std::atomic<bool> connected_ = false;
+  uint64_t alias_connect_ = 0; ///< Connection that owns the aliases.
+
+  std::atomic<size_t> in_flight_ = 0;
+  std::atomic<uint64_t> nof_published_ = 0;
+  std::atomic<uint64_t> nof_completed_ = 0;
+  std::atomic<uint64_t> nof_failed_ = 0;
+  std::atomic<uint64_t> nof_dropped_ = 0;
+
+  void IoThread();
+  void Drain();
+  void SendMessage(PublishMessage&& message);
+  [[nodiscard]] uint16_t AssignTopicAlias(const std::string& topic,
+                                         bool& send_topic);
+  void OnComplete(bool success, uint16_t alias, uint64_t connect);
+};
+
+}  // namespace bus
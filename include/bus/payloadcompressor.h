@@ -0,0 +1,79 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace bus {
+
+/** \brief Dictionary based zstd compression of MQTT payloads.
+ *
+ * Ordinary compression doesn't help on small payloads. A dictionary that
+ * is trained offline on recorded traffic makes even small JSON payloads
+ * compress well. The dictionary is trained by the zstd command line tool.
+ *
+ * ```
+ * zstd --train recorded/\* -o cantomqtt.dict
+ * ```
+ *
+ * The Compress() function is not thread-safe and shall only be called by
+ * the publish thread. The statistics may be read by any thread.
+ */
+class PayloadCompressor {
+ public:
+  PayloadCompressor();
+  virtual ~PayloadCompressor();
+
+  PayloadCompressor(const PayloadCompressor&) = delete;
+  PayloadCompressor& operator=(const PayloadCompressor&) = delete;
+
+  /** \brief Loads a dictionary file.
+   *
+   * An empty file name means compression without a dictionary.
+   * @param filename Full path to the dictionary file.
+   * @return True on success.
+   */
+  bool LoadDictionary(const std::string& filename);
+
+  /** \brief Loads a dictionary from a memory buffer.
+   *
+   * The dictionary must have a zstd dictionary header. An invalid
+   * dictionary returns false and disables the dictionary.
+   */
+  bool SetDictionary(const std::string& dictionary);
+
+  /** \brief Returns the zstd dictionary ID or 0 if no dictionary. */
+  [[nodiscard]] uint32_t DictionaryId() const { return dictionary_id_; }
+
+  void Level(int level) { level_ = level; }
+  [[nodiscard]] int Level() const { return level_; }
+
+  /** \brief Compress a payload.
+   *
+   * @param input Uncompressed payload.
+   * @param output Compressed payload.
+   * @return False if the compressed payload isn't smaller than the input.
+   */
+  bool Compress(const std::string& input, std::string& output);
+
+  [[nodiscard]] uint64_t RawBytes() const { return raw_bytes_; }
+  [[nodiscard]] uint64_t CompressedBytes() const { return compressed_bytes_; }
+
+ private:
+  struct Context;
+
+  int level_ = 3;
+  uint32_t dictionary_id_ = 0;
+  std::unique_ptr<Context> context_;
+
+  std::atomic<uint64_t> raw_bytes_ = 0;
+  std::atomic<uint64_t> compressed_bytes_ = 0;
+};
+
+}  // namespace bus
@@ -0,0 +1,128 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace bus {
+
+/** \brief Wildcard pattern that is compiled once.
+ *
+ * The pattern supports '*' (any number of characters) and '?' (any
+ * character). An empty pattern or '*' matches everything.
+ */
+class GlobPattern {
+ public:
+  GlobPattern() = default;
+  explicit GlobPattern(std::string_view pattern);
+
+  [[nodiscard]] bool Match(std::string_view text) const;
+  [[nodiscard]] bool MatchAll() const { return match_all_; }
+  [[nodiscard]] const std::string& Pattern() const { return pattern_; }
+
+ private:
+  std::string pattern_;
+  bool match_all_ = true;
+  bool exact_ = false;   ///< No wildcards. Plain compare.
+  bool anchor_front_ = true;
+  bool anchor_back_ = true;
+  std::vector<std::string> segment_list_; ///< Text between the '*'.
+};
+
+/** \brief Selects all signals that matches a range of IDs and patterns. */
+struct SelectionRule {
+  uint64_t min_ident = 0;
+  uint64_t max_ident = std::numeric_limits<uint64_t>::max();
+  GlobPattern node;    ///< DBC node (ECU) that sends the message.
+  GlobPattern message; ///< Message name.
+  GlobPattern signal;  ///< Signal name.
+};
+
+/** \brief Explicitly selected signal. */
+struct SelectedSignal {
+  uint64_t ident = 0;
+  std::string_view message_name; ///< Configured name. May be empty.
+  std::string_view signal_name;
+};
+
+/** \brief Hashed index of the selected messages and signals.
+ *
+ * Explicit selections are stored in a hash table by message ID. Rules
+ * with ID ranges and wildcards are compiled once and are only evaluated
+ * on messages that doesn't have an explicit selection or during the join
+ * with the DBC files.
+ */
+class SelectionIndex {
+ public:
+  /** \brief Adds an explicit signal selection. */
+  void AddSignal(uint64_t ident, std::string_view message_name,
+                 std::string_view signal_name);
+  void AddRule(SelectionRule rule);
+
+  /** \brief Returns true if any signal in the message may be selected.
+   *
+   * Used to skip whole DBC messages in the join.
+   */
+  [[nodiscard]] bool IsMessageSelected(uint64_t ident,
+                                       std::string_view message_name,
+                                       std::string_view node_name) const;
+
+  [[nodiscard]] bool IsSignalSelected(uint64_t ident,
+                                      std::string_view message_name,
+                                      std::string_view node_name,
+                                      std::string_view signal_name) const;
+
+  /** \brief Returns true if the signal is selected by a rule. */
+  [[nodiscard]] bool IsRuleSelected(uint64_t ident,
+                                    std::string_view message_name,
+                                    std::string_view node_name,
+                                    std::string_view signal_name) const;
+
+  /** \brief Returns the configured message name or an empty string. */
+  [[nodiscard]] std::string_view MessageName(uint64_t ident) const;
+
+  /** \brief Returns the explicit selections sorted by ID and name.
+   *
+   * The selections are returned even if they don't exist in any DBC file,
+   * so they aren't lost when the configuration is saved.
+   */
+  [[nodiscard]] std::vector<SelectedSignal> Signals() const;
+
+  [[nodiscard]] size_t NofSignals() const { return nof_signals_; }
+  [[nodiscard]] size_t NofRules() const { return rule_list_.size(); }
+  [[nodiscard]] const std::vector<SelectionRule>& Rules() const {
+    return rule_list_;
+  }
+  [[nodiscard]] bool IsEmpty() const {
+    return message_list_.empty() && rule_list_.empty();
+  }
+  void Clear();
+
+ private:
+  /** \brief Allows lookup by string views without a string copy. */
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const {
+      return std::hash<std::string_view>{}(text);
+    }
+  };
+  struct SelectedMessage {
+    std::string name;
+    std::unordered_set<std::string, StringHash, std::equal_to<>> signal_list;
+  };
+  std::unordered_map<uint64_t, SelectedMessage> message_list_;
+  std::vector<SelectionRule> rule_list_;
+  size_t nof_signals_ = 0;
+};
+
+}  // namespace bus
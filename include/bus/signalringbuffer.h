@@ -0,0 +1,67 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace bus {
+
+/** \brief Timestamped signal value. */
+struct SignalSample {
+  uint64_t timestamp = 0; ///< Nanoseconds since 1970.
+  double value = 0.0;
+};
+
+/** \brief Lock-free history of a signal's last values.
+ *
+ * The buffer has a single writer (the decode thread) and any number of
+ * readers. The writer never waits and overwrites the oldest sample when
+ * the buffer is full. A reader copies the samples and drops the samples
+ * that were overwritten during the copy.
+ */
+class SignalRingBuffer {
+ public:
+  /** \brief The capacity is rounded up to a power of 2. */
+  explicit SignalRingBuffer(size_t capacity);
+
+  /** \brief Adds a sample. Only called by the writer thread. */
+  void Push(uint64_t timestamp, double value) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    // A reader that sees the new slot values also sees the previous head.
+    std::atomic_thread_fence(std::memory_order_release);
+    auto& slot = slot_list_[head & mask_];
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  /** \brief Copies the samples within the time range (inclusive).
+   *
+   * Returns the number of copied samples.
+   */
+  size_t Snapshot(uint64_t from_time, uint64_t to_time,
+                  std::vector<SignalSample>& sample_list) const;
+
+  [[nodiscard]] size_t Capacity() const { return mask_ + 1; }
+  /** \brief Total number of pushed samples. */
+  [[nodiscard]] uint64_t NofSamples() const {
+    return head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> timestamp = 0;
+    std::atomic<double> value = 0.0;
+  };
+  std::unique_ptr<Slot[]> slot_list_;
+  size_t mask_ = 0;
+  std::atomic<uint64_t> head_ = 0;
+};
+
+}  // namespace bus
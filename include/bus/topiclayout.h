@@ -0,0 +1,62 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace bus {
+
+/** \brief Defines how CAN signals are mapped onto MQTT topics. */
+enum class TopicLayout : uint8_t {
+  PerMessage = 0, ///< One topic per CAN message. JSON with all signals.
+  PerSignal,      ///< One topic per signal. JSON with a single value.
+  PerNode,        ///< One topic per CAN message below its ECU (DBC node).
+  Custom          ///< User defined topic template.
+};
+
+[[nodiscard]] std::string_view TopicLayoutToString(TopicLayout layout);
+[[nodiscard]] TopicLayout StringToTopicLayout(std::string_view text);
+
+/** \brief Returns the topic template that a layout uses.
+ *
+ * The template may include the following place holders.
+ * - {prefix} The topic prefix, default 'CanMetrics'.
+ * - {node} The DBC node (ECU) that sends the message.
+ * - {message} The CAN message name or its ID if no name exist.
+ * - {id} The CAN message ID.
+ * - {signal} The signal name. Only used by per signal topics.
+ *
+ * @param layout Topic layout.
+ * @param custom_template Template returned for the custom layout.
+ * @return The topic template.
+ */
+[[nodiscard]] std::string TopicTemplate(TopicLayout layout,
+                                        const std::string& custom_template);
+
+/** \brief Returns true if the template creates one topic per signal. */
+[[nodiscard]] bool IsSignalTopicTemplate(std::string_view topic_template);
+
+/** \brief Returns a name as a single topic level.
+ *
+ * MQTT topic wildcards and level separators are replaced by underscores.
+ */
+[[nodiscard]] std::string TopicLevel(std::string_view name);
+
+/** \brief Replace the place holders in a topic template.
+ *
+ * MQTT topic wildcards and level separators are replaced by
+ * underscores in the inserted names.
+ */
+[[nodiscard]] std::string ExpandTopicTemplate(std::string_view topic_template,
+                                              std::string_view prefix,
+                                              std::string_view node,
+                                              std::string_view message,
+                                              int64_t message_id,
+                                              std::string_view signal);
+
+}  // namespace bus
@@ -0,0 +1,88 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bus {
+
+/** \brief Byte code operations of a trigger expression. */
+enum class TriggerOp : uint8_t {
+  Constant = 0,
+  Signal,
+  Negate,
+  Not,
+  Add,
+  Subtract,
+  Multiply,
+  Divide,
+  Less,
+  LessEqual,
+  Greater,
+  GreaterEqual,
+  Equal,
+  NotEqual,
+  And,
+  Or
+};
+
+struct TriggerInstruction {
+  TriggerOp op = TriggerOp::Constant;
+  int32_t index = 0;  ///< Signal index.
+  double value = 0.0; ///< Constant value.
+};
+
+/** \brief Condition on signal values that is compiled once.
+ *
+ * The expression is compiled into a small stack machine byte code, so the
+ * evaluation doesn't need any parsing or memory allocations.
+ * ```
+ * BatteryTemp > 60 && Speed > 0
+ * (Current * Voltage >= 2000 or Fault == 1) and not Test
+ * ```
+ * Operators: `|| or`, `&& and`, `! not`, `< <= > >= == = !=`, `+ - * /`
+ * and parentheses. Booleans are 0 (false) or 1 (true). The signal names
+ * may be qualified with the message name, `Message.Signal`.
+ */
+class TriggerExpression {
+ public:
+  /** \brief Returns the signal index of a signal name. */
+  using SignalResolver = std::function<int32_t(std::string_view name)>;
+
+  bool Compile(std::string_view expression, const SignalResolver& resolver);
+
+  /** \brief Evaluates the expression. The values are indexed by signal. */
+  [[nodiscard]] double Evaluate(std::span<const double> value_list) const;
+  [[nodiscard]] bool IsTrue(std::span<const double> value_list) const {
+    return Evaluate(value_list) != 0.0;
+  }
+
+  [[nodiscard]] const std::string& Expression() const { return expression_; }
+  /** \brief Unique signal indexes used by the expression. */
+  [[nodiscard]] const std::vector<int32_t>& Signals() const {
+    return signal_list_;
+  }
+  [[nodiscard]] const std::vector<TriggerInstruction>& Instructions() const {
+    return instruction_list_;
+  }
+  [[nodiscard]] bool IsEmpty() const { return instruction_list_.empty(); }
+  [[nodiscard]] const std::string& LastError() const { return last_error_; }
+
+  static constexpr size_t kMaxStack = 32;
+
+ private:
+  std::string expression_;
+  std::vector<TriggerInstruction> instruction_list_;
+  std::vector<int32_t> signal_list_;
+  std::string last_error_;
+};
+
+}  // namespace bus
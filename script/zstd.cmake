@@ -0,0 +1,29 @@
+# Copyright 2025 Ingemar Hedvall
+# SPDX-License-Identifier: MIT
+
+if (NOT zstd_FOUND)
+    find_package(zstd CONFIG)
+    if (NOT zstd_FOUND)
+        if (COMP_DIR)
+            set(zstd_ROOT ${COMP_DIR}/zstd/master)
+        endif()
+        find_package(zstd CONFIG REQUIRED)
+    endif()
+endif()
+
+# The exported target name depends on the zstd version and build type.
+if (TARGET zstd::libzstd_static)
+    set(ZSTD_TARGET zstd::libzstd_static)
+elseif (TARGET zstd::libzstd_shared)
+    set(ZSTD_TARGET zstd::libzstd_shared)
+else()
+    set(ZSTD_TARGET zstd::libzstd)
+endif()
+
+get_target_property(ZSTD_INCLUDE_DIRS ${ZSTD_TARGET} INTERFACE_INCLUDE_DIRECTORIES)
+
+cmake_print_variables(
+        zstd_FOUND
+        zstd_VERSION
+        ZSTD_TARGET
+        ZSTD_INCLUDE_DIRS)
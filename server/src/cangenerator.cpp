@@ -0,0 +1,396 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "cangenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include <dbc/dbcfile.h>
+
+#include <util/logstream.h>
+
+#include <bus/candataframe.h>
+
+using namespace util::log;
+using namespace dbc;
+using namespace std::chrono;
+
+namespace {
+
+constexpr uint64_t kExtendedFlag = 0x80000000;
+constexpr uint64_t kExtendedMask = 0x1FFFFFFF;
+constexpr size_t kRampSteps = 100;
+
+/** \brief Returns the number of data bytes the signal needs. */
+size_t SignalBytes(const bus::CompactSignal& signal) {
+  if (signal.bit_length == 0) {
+    return 0;
+  }
+  if (signal.little_endian) {
+    return (signal.start_bit + signal.bit_length + 7) / 8;
+  }
+  size_t bit = signal.start_bit;
+  size_t max_bit = bit;
+  for (size_t count = 1; count < signal.bit_length; ++count) {
+    bit = bit % 8 == 0 ? bit + 15 : bit - 1;
+    max_bit = std::max(max_bit, bit);
+  }
+  return max_bit / 8 + 1;
+}
+
+std::chrono::nanoseconds CycleTime(const Message& message,
+                                   std::chrono::milliseconds def_time) {
+  if (const auto* attribute = message.GetAttribute("GenMsgCycleTime");
+      attribute != nullptr) {
+    const auto cycle_time = attribute->Value<double>();
+    if (cycle_time > 0.0) {
+      return duration_cast<nanoseconds>(duration<double, std::milli>(
+        cycle_time));
+    }
+  }
+  return def_time;
+}
+
+/** \brief Converts an engineering value to a clamped raw value. */
+uint64_t RawFromEng(const bus::CompactSignal& signal, double value) {
+  const double scale = signal.scale != 0.0 ? signal.scale : 1.0;
+  const double raw = (value - signal.offset) / scale;
+  switch (signal.data_type) {
+    case bus::RawDataType::Float:
+      return std::bit_cast<uint32_t>(static_cast<float>(raw));
+
+    case bus::RawDataType::Double:
+      return std::bit_cast<uint64_t>(raw);
+
+    case bus::RawDataType::Signed: {
+      const double max = std::ldexp(1.0, signal.bit_length - 1) - 1.0;
+      const double clamped = std::clamp(std::round(raw), -max - 1.0, max);
+      const uint64_t mask = signal.bit_length >= 64 ? ~0ULL
+                          : (1ULL << signal.bit_length) - 1;
+      return std::bit_cast<uint64_t>(static_cast<int64_t>(clamped)) & mask;
+    }
+
+    default:
+      break;
+  }
+  const double max = std::ldexp(1.0, signal.bit_length) - 1.0;
+  return static_cast<uint64_t>(std::clamp(std::round(raw), 0.0, max));
+}
+
+}  // namespace
+
+namespace bus {
+
+CanGenerator::~CanGenerator() {
+  Stop();
+}
+
+bool CanGenerator::ReadDbcFile(const std::string& filename) {
+  try {
+    DbcFile dbc_file;
+    dbc_file.Filename(filename);
+    if (const bool parse = dbc_file.ParseFile(); !parse) {
+      throw std::runtime_error(dbc_file.LastError());
+    }
+    const auto* network = dbc_file.GetNetwork();
+    if (network == nullptr) {
+      throw std::runtime_error("No network found in the DBC file.");
+    }
+
+    auto& strings = dbc_.Strings();
+    for (const auto& [ident, message] : network->Messages()) {
+      CompactMessage compact;
+      compact.ident = ident;
+      compact.name = strings.Intern(message.Name());
+      compact.node = strings.Intern(message.Node());
+
+      // Signals that the compact model can't encode are left as zeros.
+      const bool extended_mux = HasExtendedMux(message);
+      if (extended_mux) {
+        LOG_WARNING() << "Extended multiplexing is not supported. Only "
+          << "the non-multiplexed signals are generated. Message: "
+          << message.Name();
+      }
+      std::vector<std::pair<double, double>> range_list;
+      for (const auto& [signal_name, signal] : message.Signals()) {
+        if (signal.BitLength() == 0 || signal.BitLength() > 64
+            || !IsSupportedSignal(signal, extended_mux)) {
+          continue;
+        }
+        compact.signal_list.emplace_back(MakeCompactSignal(signal, dbc_));
+        range_list.emplace_back(signal.Min(), signal.Max());
+      }
+
+      const auto* added = dbc_.AddMessage(std::move(compact));
+      if (added == nullptr) {
+        continue;
+      }
+      GeneratedMessage generated;
+      generated.ident = ident;
+      generated.message = added;
+      generated.dbc_cycle_time = CycleTime(message, default_cycle_time_);
+      generated.cycle_time = generated.dbc_cycle_time;
+      size_t nof_bytes = 0;
+      for (size_t index = 0; index < added->signal_list.size(); ++index) {
+        const auto& signal = added->signal_list[index];
+        auto [min, max] = range_list[index];
+        if (min >= max) {
+          // No range in the DBC file. Use the raw range instead.
+          const double raw_max = std::ldexp(1.0,
+            std::min<int>(signal.bit_length, 32)) - 1.0;
+          min = signal.offset;
+          max = raw_max * signal.scale + signal.offset;
+          if (min > max) {
+            std::swap(min, max);
+          }
+        }
+        generated.signal_list.push_back({&signal, min, max});
+        nof_bytes = std::max(nof_bytes, SignalBytes(signal));
+        if (signal.mux == RawMuxType::Multiplexed) {
+          generated.mux_value_list.push_back(signal.mux_value);
+        }
+      }
+      std::ranges::sort(generated.mux_value_list);
+      const auto [first, last] = std::ranges::unique(generated.mux_value_list);
+      generated.mux_value_list.erase(first, last);
+      generated.nof_bytes = DataLength(message.NofBytes(), nof_bytes);
+      generated.fd = generated.nof_bytes > 8;
+      message_list_.emplace_back(std::move(generated));
+    }
+    dbc_.Finalize();
+    if (message_list_.empty()) {
+      throw std::runtime_error("No messages found in the DBC file.");
+    }
+  } catch (const std::exception& err) {
+    LOG_ERROR() << "Failed to read the DBC file. File: " << filename
+      << ", Error: " << err.what();
+    return false;
+  }
+  return true;
+}
+
+size_t CanGenerator::FrameBits(size_t nof_bytes, bool extended, bool fd) {
+  if (!fd) {
+    // SOF, ID, control, CRC, ACK and EOF fields. Interframe space included.
+    const size_t frame_bits = (extended ? 67 : 47) + 8 * nof_bytes;
+    // Worst case bit stuffing. EOF and interframe space aren't stuffed.
+    return frame_bits + (frame_bits - 13 - 1) / 4;
+  }
+  // SOF, ID and control fields. The dynamic bit stuffing ends at the CRC.
+  const size_t stuffed_bits = (extended ? 41 : 22) + 8 * nof_bytes;
+  // Stuff count and CRC with a fixed stuff bit for each 4 bits.
+  const size_t crc_bits = 4 + (nof_bytes <= 16 ? 17 : 21);
+  // CRC delimiter, ACK, EOF and interframe space.
+  return stuffed_bits + (stuffed_bits - 1) / 4 + (crc_bits * 5 + 3) / 4 + 13;
+}
+
+size_t CanGenerator::DataLength(size_t dbc_bytes, size_t signal_bytes) {
+  const size_t nof_bytes = std::max(dbc_bytes, signal_bytes);
+  if (nof_bytes <= 8) {
+    return nof_bytes;
+  }
+  constexpr std::array<size_t, 7> kFdLengths = {12, 16, 20, 24, 32, 48, 64};
+  for (const size_t length : kFdLengths) {
+    if (nof_bytes <= length) {
+      return length;
+    }
+  }
+  return kFdLengths.back();
+}
+
+double CanGenerator::EstimatedBusLoad() const {
+  if (bit_rate_ == 0) {
+    return 0.0;
+  }
+  double bits_per_second = 0.0;
+  for (const auto& message : message_list_) {
+    if (message.cycle_time.count() <= 0) {
+      continue;
+    }
+    const auto bits = static_cast<double>(FrameBits(message.nof_bytes,
+      (message.ident & kExtendedFlag) != 0, message.fd));
+    bits_per_second += bits / duration<double>(message.cycle_time).count();
+  }
+  return 100.0 * bits_per_second / bit_rate_;
+}
+
+void CanGenerator::ScaleCycleTimes() {
+  for (auto& message : message_list_) {
+    message.cycle_time = message.dbc_cycle_time;
+  }
+  if (bus_load_ <= 0.0) {
+    return;
+  }
+  const double target = std::min(bus_load_, 100.0);
+  const double load = EstimatedBusLoad();
+  if (load <= 0.0) {
+    return;
+  }
+  // All cycle times are scaled with the same factor so the relative
+  // timing between the messages is kept.
+  const double factor = load / target;
+  for (auto& message : message_list_) {
+    const auto cycle_time = static_cast<double>(message.cycle_time.count())
+                          * factor;
+    message.cycle_time = nanoseconds(std::max<int64_t>(1,
+      static_cast<int64_t>(cycle_time)));
+  }
+}
+
+bool CanGenerator::Burst(size_t nof_frames,
+                         std::chrono::milliseconds period) {
+  if (nof_frames > 0 && period.count() <= 0) {
+    // The next burst would never be later than the current burst.
+    LOG_ERROR() << "The burst period must be larger than 0 ms. Period: "
+      << period.count();
+    burst_frames_ = 0;
+    return false;
+  }
+  burst_frames_ = nof_frames;
+  burst_period_ = period;
+  return true;
+}
+
+void CanGenerator::TakeFrames(std::vector<SentFrame>& frame_list) {
+  frame_list.clear();
+  std::scoped_lock lock(frame_mutex_);
+  frame_list.swap(frame_list_);
+}
+
+bool CanGenerator::Start(std::shared_ptr<IBusMessageQueue> publisher) {
+  Stop();
+  if (!publisher || message_list_.empty()) {
+    LOG_ERROR() << "No publisher or messages. Invalid use of function.";
+    return false;
+  }
+  publisher_ = std::move(publisher);
+  ScaleCycleTimes();
+  nof_frames_ = 0;
+  {
+    std::scoped_lock lock(frame_mutex_);
+    frame_list_.clear();
+  }
+  stop_thread_ = false;
+  work_thread_ = std::thread(&CanGenerator::WorkingThread, this);
+  return true;
+}
+
+void CanGenerator::Stop() {
+  stop_thread_ = true;
+  if (work_thread_.joinable()) {
+    work_thread_.join();
+  }
+  if (publisher_) {
+    publisher_->Stop();
+    publisher_.reset();
+  }
+}
+
+void CanGenerator::WorkingThread() {
+  using Due = std::pair<steady_clock::time_point, size_t>;
+  std::priority_queue<Due, std::vector<Due>, std::greater<>> schedule;
+
+  // Spread the first frames over the first cycle, so the start doesn't
+  // become one large burst.
+  const auto start = steady_clock::now();
+  for (size_t index = 0; index < message_list_.size(); ++index) {
+    const auto offset = message_list_[index].cycle_time * index
+                      / message_list_.size();
+    schedule.emplace(start + offset, index);
+  }
+  auto next_burst = start + burst_period_;
+  size_t burst_index = 0;
+
+  while (!stop_thread_ && !schedule.empty()) {
+    auto [due, index] = schedule.top();
+    if (burst_frames_ > 0 && burst_period_.count() > 0 && next_burst < due) {
+      std::this_thread::sleep_until(next_burst);
+      for (size_t frame = 0; frame < burst_frames_ && !stop_thread_;
+           ++frame) {
+        SendMessage(message_list_[burst_index++ % message_list_.size()]);
+      }
+      next_burst += burst_period_;
+      continue;
+    }
+
+    schedule.pop();
+    std::this_thread::sleep_until(due);
+    auto& message = message_list_[index];
+    SendMessage(message);
+    // Keep the nominal rate. A late frame doesn't move the later frames.
+    schedule.emplace(due + message.cycle_time, index);
+  }
+}
+
+void CanGenerator::SendMessage(GeneratedMessage& message) {
+  std::vector<uint8_t> data(message.nof_bytes, 0);
+  const uint64_t counter = message.counter++;
+
+  int32_t mux_value = 0;
+  if (!message.mux_value_list.empty()) {
+    mux_value = message.mux_value_list[counter % message.mux_value_list.size()];
+  }
+
+  for (const auto& generated : message.signal_list) {
+    const auto& signal = *generated.signal;
+    uint64_t raw = 0;
+    switch (signal.mux) {
+      case RawMuxType::Multiplexor:
+        raw = static_cast<uint64_t>(mux_value);
+        break;
+
+      case RawMuxType::Multiplexed:
+        if (signal.mux_value != mux_value) {
+          continue;
+        }
+        raw = RawFromEng(signal, NextValue(generated, counter));
+        break;
+
+      default:
+        raw = RawFromEng(signal, NextValue(generated, counter));
+        break;
+    }
+    CompactDbc::SetRawValue(signal, data, raw);
+  }
+
+  auto frame = std::make_shared<CanDataFrame>();
+  frame->MessageId(static_cast<uint32_t>(message.ident & kExtendedMask));
+  frame->ExtendedId((message.ident & kExtendedFlag) != 0);
+  frame->DataBytes(data);
+  // Unique timestamps identify the frames in the MQTT payloads.
+  const auto now = static_cast<uint64_t>(duration_cast<nanoseconds>(
+    system_clock::now().time_since_epoch()).count());
+  last_timestamp_ = std::max(now, last_timestamp_ + 1);
+  frame->Timestamp(last_timestamp_);
+  if (track_frames_) {
+    const uint64_t key = (message.ident << 32)
+                       | static_cast<uint32_t>(mux_value);
+    std::scoped_lock lock(frame_mutex_);
+    frame_list_.push_back({last_timestamp_, key});
+  }
+  publisher_->Push(frame);
+  ++nof_frames_;
+}
+
+double CanGenerator::NextValue(const GeneratedSignal& signal,
+                               uint64_t counter) {
+  if (values_ == GeneratorValues::Random) {
+    std::uniform_real_distribution<double> distribution(signal.min,
+                                                        signal.max);
+    return distribution(random_);
+  }
+  // The ramp changes each frame, so each frame updates the metrics.
+  const auto step = static_cast<double>(counter % kRampSteps);
+  return signal.min + (signal.max - signal.min) * step / (kRampSteps - 1);
+}
+
+}  // namespace bus
@@ -0,0 +1,156 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <bus/ibusmessagequeue.h>
+#include <bus/compactdbc.h>
+
+namespace bus {
+
+/** \brief How the signal values are generated. */
+enum class GeneratorValues {
+  Ramp,   ///< Saw-tooth between the min and max value.
+  Random  ///< Uniform random values between min and max value.
+};
+
+/** \brief Generates synthetic CAN traffic from a DBC file.
+ *
+ * The messages are sent with the cycle time defined by the DBC
+ * 'GenMsgCycleTime' attribute. The cycle times may be scaled to reach
+ * a specific bus load. Bursts of back-to-back frames may be added on top
+ * of the cyclic traffic.
+ *
+ * The frames are pushed into a bus publisher queue, i.e. into the TCP or
+ * shared memory bus broker. The frame timestamp is the system time in
+ * nanoseconds so the receiver can calculate the end-to-end latency. The
+ * timestamps are unique, so they also identify the frames in the MQTT
+ * payloads.
+ *
+ * The data length is the DBC message length. Messages longer than 8 bytes
+ * are sent as CAN FD frames.
+ */
+class CanGenerator {
+ public:
+  /** \brief Sent frame. The key is the message ident and mux value. */
+  struct SentFrame {
+    uint64_t timestamp = 0;
+    uint64_t key = 0;
+  };
+
+  CanGenerator() = default;
+  virtual ~CanGenerator();
+
+  bool ReadDbcFile(const std::string& filename);
+
+  void BitRate(uint32_t bit_rate) { bit_rate_ = bit_rate; }
+  [[nodiscard]] uint32_t BitRate() const { return bit_rate_; }
+
+  /** \brief Target bus load in percent (0-100). 0 = DBC cycle times. */
+  void BusLoad(double bus_load) { bus_load_ = bus_load; }
+  [[nodiscard]] double BusLoad() const { return bus_load_; }
+
+  /** \brief Cycle time for messages without a cycle time attribute. */
+  void DefaultCycleTime(std::chrono::milliseconds cycle_time) {
+    default_cycle_time_ = cycle_time;
+  }
+
+  void Values(GeneratorValues values) { values_ = values; }
+  [[nodiscard]] GeneratorValues Values() const { return values_; }
+
+  /** \brief Sends a burst of frames each period. 0 frames = no bursts.
+   *
+   * The period must be larger than 0 ms. An invalid period disables the
+   * bursts and returns false.
+   */
+  bool Burst(size_t nof_frames, std::chrono::milliseconds period);
+  [[nodiscard]] size_t BurstFrames() const { return burst_frames_; }
+
+  /** \brief Stores the sent frames until they are taken. */
+  void TrackFrames(bool track) { track_frames_ = track; }
+  /** \brief Moves the frames that were sent since the last call. */
+  void TakeFrames(std::vector<SentFrame>& frame_list);
+
+  bool Start(std::shared_ptr<IBusMessageQueue> publisher);
+  void Stop();
+
+  [[nodiscard]] size_t NofMessages() const { return message_list_.size(); }
+  [[nodiscard]] uint64_t NofFrames() const { return nof_frames_; }
+  /** \brief Estimated bus load in percent with the scaled cycle times. */
+  [[nodiscard]] double EstimatedBusLoad() const;
+
+  /** \brief Number of bits on the bus including worst case bit stuffing.
+   *
+   * The CAN FD bits assume that the data phase uses the nominal bit rate.
+   */
+  [[nodiscard]] static size_t FrameBits(size_t nof_bytes, bool extended,
+                                        bool fd);
+  /** \brief Returns the data length of a message.
+   *
+   * The DBC length is used if the signals fit. Lengths above 8 bytes are
+   * rounded up to a valid CAN FD length.
+   */
+  [[nodiscard]] static size_t DataLength(size_t dbc_bytes,
+                                         size_t signal_bytes);
+
+ private:
+  struct GeneratedSignal {
+    const CompactSignal* signal = nullptr;
+    double min = 0.0;
+    double max = 0.0;
+  };
+
+  struct GeneratedMessage {
+    uint64_t ident = 0;
+    const CompactMessage* message = nullptr;
+    size_t nof_bytes = 8;
+    bool fd = false; ///< CAN FD frame.
+    std::chrono::nanoseconds dbc_cycle_time = {}; ///< Unscaled cycle time.
+    std::chrono::nanoseconds cycle_time = {};
+    std::vector<GeneratedSignal> signal_list;
+    std::vector<int32_t> mux_value_list; ///< Sorted unique mux values.
+    uint64_t counter = 0;
+  };
+
+  CompactDbc dbc_;
+  std::vector<GeneratedMessage> message_list_;
+
+  uint32_t bit_rate_ = 500'000;
+  double bus_load_ = 0.0;
+  std::chrono::milliseconds default_cycle_time_ =
+    std::chrono::milliseconds(100);
+  GeneratorValues values_ = GeneratorValues::Ramp;
+  size_t burst_frames_ = 0;
+  std::chrono::milliseconds burst_period_ = std::chrono::milliseconds(1000);
+
+  std::shared_ptr<IBusMessageQueue> publisher_;
+  std::thread work_thread_;
+  std::atomic<bool> stop_thread_ = true;
+  std::atomic<uint64_t> nof_frames_ = 0;
+  uint64_t last_timestamp_ = 0;
+  std::mt19937_64 random_;
+
+  std::atomic<bool> track_frames_ = false;
+  std::mutex frame_mutex_;
+  std::vector<SentFrame> frame_list_;
+
+  void ScaleCycleTimes();
+  void WorkingThread();
+  void SendMessage(GeneratedMessage& message);
+  [[nodiscard]] double NextValue(const GeneratedSignal& signal,
+                                 uint64_t counter);
+};
+
+}  // namespace bus
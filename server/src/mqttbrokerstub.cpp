@@ -0,0 +1,501 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "mqttbrokerstub.h"
+
+#include <util/logstream.h>
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+
+using namespace util::log;
+using namespace std::chrono;
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+namespace {
+
+enum class PacketType : uint8_t {
+  Connect = 1,
+  Publish = 3,
+  PubRel = 6,
+  Subscribe = 8,
+  PingReq = 12,
+  Disconnect = 14
+};
+
+constexpr uint8_t kProtocolVersion5 = 5;
+
+uint64_t NowNs() {
+  return static_cast<uint64_t>(duration_cast<nanoseconds>(
+    system_clock::now().time_since_epoch()).count());
+}
+
+/** \brief Reads the fixed header remaining length (variable byte integer).
+ *
+ * Returns the length and the number of bytes used, or nothing if more
+ * bytes are needed.
+ */
+std::optional<std::pair<size_t, size_t>> ReadVarInt(
+    std::string_view buffer, size_t pos) {
+  size_t value = 0;
+  for (size_t count = 0; count < 4; ++count) {
+    if (pos + count >= buffer.size()) {
+      return std::nullopt;
+    }
+    const auto in_byte = static_cast<uint8_t>(buffer[pos + count]);
+    value |= static_cast<size_t>(in_byte & 0x7F) << (7 * count);
+    if ((in_byte & 0x80) == 0) {
+      return std::make_pair(value, count + 1);
+    }
+  }
+  throw std::runtime_error("Invalid variable length.");
+}
+
+uint16_t ReadUint16(std::string_view packet, size_t& pos) {
+  if (pos + 2 > packet.size()) {
+    throw std::runtime_error("Packet too short.");
+  }
+  const auto value = static_cast<uint16_t>(
+    (static_cast<uint8_t>(packet[pos]) << 8)
+    | static_cast<uint8_t>(packet[pos + 1]));
+  pos += 2;
+  return value;
+}
+
+std::string_view ReadString(std::string_view packet, size_t& pos) {
+  const size_t length = ReadUint16(packet, pos);
+  if (pos + length > packet.size()) {
+    throw std::runtime_error("Packet too short.");
+  }
+  const auto text = packet.substr(pos, length);
+  pos += length;
+  return text;
+}
+
+/** \brief Returns the topic alias property or 0 if not found. */
+uint16_t TopicAlias(std::string_view properties) {
+  size_t pos = 0;
+  while (pos < properties.size()) {
+    const auto ident = static_cast<uint8_t>(properties[pos++]);
+    switch (ident) {
+      case 0x01: // Payload format indicator
+        pos += 1;
+        break;
+
+      case 0x02: // Message expiry interval
+        pos += 4;
+        break;
+
+      case 0x23: // Topic alias
+        return ReadUint16(properties, pos);
+
+      case 0x03: // Content type
+      case 0x08: // Response topic
+      case 0x09: // Correlation data
+        std::ignore = ReadString(properties, pos);
+        break;
+
+      case 0x26: // User property
+        std::ignore = ReadString(properties, pos);
+        std::ignore = ReadString(properties, pos);
+        break;
+
+      case 0x0B: { // Subscription identifier
+        const auto var_int = ReadVarInt(properties, pos);
+        pos += var_int ? var_int->second : properties.size();
+        break;
+      }
+
+      default:
+        return 0;
+    }
+  }
+  return 0;
+}
+
+/** \brief Returns the JSON timestamp of the payload or 0. */
+uint64_t PayloadTimestamp(std::string_view payload) {
+  constexpr std::string_view kTag = "\"timestamp\":";
+  const size_t pos = payload.find(kTag);
+  if (pos == std::string_view::npos) {
+    return 0;
+  }
+  const char* first = payload.data() + pos + kTag.size();
+  const char* last = payload.data() + payload.size();
+  uint64_t timestamp = 0;
+  if (const auto [ptr, error] = std::from_chars(first, last, timestamp);
+      error != std::errc()) {
+    return 0;
+  }
+  return timestamp;
+}
+
+class Session : public std::enable_shared_from_this<Session> {
+ public:
+  Session(tcp::socket socket, bus::MqttBrokerStub& broker)
+  : socket_(std::move(socket)),
+    broker_(broker) {}
+
+  void DoRead() {
+    auto self = shared_from_this();
+    socket_.async_read_some(asio::buffer(read_buffer_),
+      [self] (const boost::system::error_code& error, size_t nof_bytes) {
+        if (error) {
+          return;
+        }
+        self->buffer_.append(self->read_buffer_.data(), nof_bytes);
+        self->OnRead();
+      });
+  }
+
+  /** \brief Sends the acknowledges that were held back. */
+  void ReleaseAcks() {
+    write_buffer_ += held_buffer_;
+    held_buffer_.clear();
+    DoWrite();
+  }
+
+  void Close() {
+    boost::system::error_code error;
+    socket_.shutdown(tcp::socket::shutdown_both, error);
+    socket_.close(error);
+  }
+
+ private:
+  tcp::socket socket_;
+  bus::MqttBrokerStub& broker_;
+  std::array<char, 64 * 1024> read_buffer_ = {};
+  std::string buffer_;       ///< Received but not handled bytes.
+  std::string write_buffer_; ///< Replies to the client.
+  std::string held_buffer_;  ///< Acknowledges that are held back.
+  bool writing_ = false;
+  uint8_t version_ = kProtocolVersion5;
+  bool disconnect_ = false;
+  std::unordered_map<uint16_t, std::string> alias_list_;
+
+  void OnRead() {
+    try {
+      size_t pos = 0;
+      while (pos + 2 <= buffer_.size()) {
+        const auto length = ReadVarInt(buffer_, pos + 1);
+        if (!length) {
+          break;
+        }
+        const auto [remaining, nof_length_bytes] = *length;
+        const size_t header_size = 1 + nof_length_bytes;
+        if (pos + header_size + remaining > buffer_.size()) {
+          break;
+        }
+        const auto first_byte = static_cast<uint8_t>(buffer_[pos]);
+        const std::string_view packet(buffer_.data() + pos + header_size,
+                                      remaining);
+        OnPacket(first_byte, packet);
+        pos += header_size + remaining;
+      }
+      buffer_.erase(0, pos);
+    } catch (const std::exception& err) {
+      LOG_ERROR() << "Invalid MQTT packet. Error: " << err.what();
+      disconnect_ = true;
+    }
+    DoWrite();
+    if (!disconnect_) {
+      DoRead();
+    }
+  }
+
+  /** \brief Writes the replies. Only one write is outstanding. */
+  void DoWrite() {
+    if (writing_ || write_buffer_.empty()) {
+      return;
+    }
+    writing_ = true;
+    auto self = shared_from_this();
+    auto reply = std::make_shared<std::string>();
+    reply->swap(write_buffer_);
+    asio::async_write(socket_, asio::buffer(*reply),
+      [self, reply] (const boost::system::error_code& error, size_t) {
+        self->writing_ = false;
+        if (!error) {
+          self->DoWrite();
+        }
+      });
+  }
+
+  void AddReply(std::initializer_list<uint8_t> bytes) {
+    for (const uint8_t out_byte : bytes) {
+      write_buffer_.push_back(static_cast<char>(out_byte));
+    }
+  }
+
+  /** \brief Adds a PUBACK (QoS 1) or PUBREC (QoS 2) reply. */
+  void AddAck(uint8_t qos, uint16_t packet_id) {
+    std::string& buffer = broker_.HoldAcks() ? held_buffer_ : write_buffer_;
+    const bool reject = broker_.RejectPublishes()
+      && version_ >= kProtocolVersion5;
+    buffer.push_back(static_cast<char>(qos == 1 ? 0x40 : 0x50));
+    buffer.push_back(static_cast<char>(reject ? 0x03 : 0x02));
+    buffer.push_back(static_cast<char>(packet_id >> 8));
+    buffer.push_back(static_cast<char>(packet_id & 0xFF));
+    if (reject) {
+      buffer.push_back(static_cast<char>(0x80)); // Unspecified error
+    }
+  }
+
+  void OnPacket(uint8_t first_byte, std::string_view packet) {
+    switch (static_cast<PacketType>(first_byte >> 4)) {
+      case PacketType::Connect:
+        OnConnect(packet);
+        break;
+
+      case PacketType::Publish:
+        OnPublish(first_byte, packet);
+        break;
+
+      case PacketType::PubRel: {
+        size_t pos = 0;
+        const auto packet_id = ReadUint16(packet, pos);
+        AddReply({0x70, 0x02, static_cast<uint8_t>(packet_id >> 8),
+                  static_cast<uint8_t>(packet_id & 0xFF)});
+        break;
+      }
+
+      case PacketType::Subscribe: {
+        // Subscriptions are accepted but nothing is forwarded.
+        size_t pos = 0;
+        const auto packet_id = ReadUint16(packet, pos);
+        if (version_ >= kProtocolVersion5) {
+          AddReply({0x90, 0x04, static_cast<uint8_t>(packet_id >> 8),
+                    static_cast<uint8_t>(packet_id & 0xFF), 0x00, 0x00});
+        } else {
+          AddReply({0x90, 0x03, static_cast<uint8_t>(packet_id >> 8),
+                    static_cast<uint8_t>(packet_id & 0xFF), 0x00});
+        }
+        break;
+      }
+
+      case PacketType::PingReq:
+        AddReply({0xD0, 0x00});
+        break;
+
+      case PacketType::Disconnect:
+        disconnect_ = true;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  void OnConnect(std::string_view packet) {
+    size_t pos = 0;
+    std::ignore = ReadString(packet, pos); // Protocol name
+    if (pos >= packet.size()) {
+      throw std::runtime_error("Packet too short.");
+    }
+    version_ = static_cast<uint8_t>(packet[pos]);
+    alias_list_.clear();
+    broker_.OnConnect();
+    if (version_ >= kProtocolVersion5) {
+      // Allow max number of topic aliases and in-flight messages.
+      AddReply({0x20, 0x09, 0x00, 0x00, 0x06,
+                0x22, 0xFF, 0xFF,    // Topic alias maximum
+                0x21, 0xFF, 0xFF});  // Receive maximum
+    } else {
+      AddReply({0x20, 0x02, 0x00, 0x00});
+    }
+  }
+
+  void OnPublish(uint8_t first_byte, std::string_view packet) {
+    const uint64_t now = NowNs();
+    const auto qos = static_cast<uint8_t>((first_byte >> 1) & 0x03);
+    size_t pos = 0;
+    const auto topic = ReadString(packet, pos);
+    uint16_t packet_id = 0;
+    if (qos > 0) {
+      packet_id = ReadUint16(packet, pos);
+    }
+    if (version_ >= kProtocolVersion5) {
+      const auto length = ReadVarInt(packet, pos);
+      if (!length || pos + length->second + length->first > packet.size()) {
+        throw std::runtime_error("Invalid publish properties.");
+      }
+      const auto properties = packet.substr(pos + length->second,
+                                            length->first);
+      pos += length->second + length->first;
+      // The topic is only sent the first time an alias is used.
+      if (const uint16_t alias = TopicAlias(properties); alias > 0) {
+        if (!topic.empty()) {
+          alias_list_[alias] = std::string(topic);
+        } else {
+          const bool known_alias = alias_list_.contains(alias);
+          broker_.OnAliasPublish(known_alias);
+          if (!known_alias) {
+            throw std::runtime_error("Unknown topic alias.");
+          }
+        }
+      }
+    }
+
+    const auto payload = packet.substr(pos);
+    broker_.OnPublish(payload.size(), PayloadTimestamp(payload), now);
+
+    if (qos > 0) {
+      AddAck(qos, packet_id);
+    }
+  }
+};
+
+}  // namespace
+
+namespace bus {
+
+struct MqttBrokerStub::Context {
+  asio::io_context ioc;
+  tcp::acceptor acceptor;
+  /// Only used by the io thread.
+  std::vector<std::weak_ptr<Session>> session_list;
+
+  Context()
+  : acceptor(ioc) {}
+};
+
+MqttBrokerStub::MqttBrokerStub() = default;
+
+MqttBrokerStub::~MqttBrokerStub() {
+  MqttBrokerStub::Stop();
+}
+
+bool MqttBrokerStub::Start() {
+  Stop();
+  try {
+    context_ = std::make_unique<Context>();
+    const tcp::endpoint endpoint(tcp::v4(), port_);
+    auto& acceptor = context_->acceptor;
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+    port_ = acceptor.local_endpoint().port();
+    DoAccept();
+    io_thread_ = std::thread([this] { context_->ioc.run(); });
+  } catch (const std::exception& err) {
+    LOG_ERROR() << "Failed to start the MQTT broker. Port: " << port_
+      << ", Error: " << err.what();
+    context_.reset();
+    return false;
+  }
+  return true;
+}
+
+void MqttBrokerStub::Stop() {
+  if (!context_) {
+    return;
+  }
+  context_->ioc.stop();
+  if (io_thread_.joinable()) {
+    io_thread_.join();
+  }
+  context_.reset();
+}
+
+void MqttBrokerStub::DoAccept() {
+  context_->acceptor.async_accept(
+    [this] (const boost::system::error_code& error, tcp::socket socket) {
+      if (error) {
+        return;
+      }
+      socket.set_option(tcp::no_delay(true));
+      auto session = std::make_shared<Session>(std::move(socket), *this);
+      auto& session_list = context_->session_list;
+      std::erase_if(session_list, [] (const std::weak_ptr<Session>& item) {
+        return item.expired();
+      });
+      session_list.emplace_back(session);
+      session->DoRead();
+      DoAccept();
+    });
+}
+
+void MqttBrokerStub::HoldAcks(bool hold) {
+  hold_acks_ = hold;
+  if (hold || !context_) {
+    return;
+  }
+  asio::post(context_->ioc, [this] {
+    for (const auto& item : context_->session_list) {
+      if (auto session = item.lock(); session) {
+        session->ReleaseAcks();
+      }
+    }
+  });
+}
+
+void MqttBrokerStub::DropConnections() {
+  if (!context_) {
+    return;
+  }
+  asio::post(context_->ioc, [this] {
+    for (const auto& item : context_->session_list) {
+      if (auto session = item.lock(); session) {
+        session->Close();
+      }
+    }
+  });
+}
+
+void MqttBrokerStub::OnConnect() {
+  ++nof_connections_;
+}
+
+void MqttBrokerStub::OnPublish(size_t nof_bytes, uint64_t timestamp,
+                               uint64_t now) {
+  ++nof_publishes_;
+  nof_bytes_ += nof_bytes;
+  last_publish_ = now;
+  if (timestamp == 0) {
+    return;
+  }
+  std::scoped_lock lock(latency_mutex_);
+  if (timestamp <= now) {
+    latency_list_.push_back(static_cast<int64_t>(now - timestamp));
+  }
+  if (track_timestamps_) {
+    timestamp_list_.push_back(timestamp);
+  }
+}
+
+void MqttBrokerStub::OnAliasPublish(bool known_alias) {
+  if (known_alias) {
+    ++nof_alias_publishes_;
+  } else {
+    ++nof_alias_errors_;
+  }
+}
+
+void MqttBrokerStub::TakeLatencies(std::vector<int64_t>& latency_list) {
+  latency_list.clear();
+  std::scoped_lock lock(latency_mutex_);
+  latency_list.swap(latency_list_);
+}
+
+void MqttBrokerStub::TakeTimestamps(std::vector<uint64_t>& timestamp_list) {
+  timestamp_list.clear();
+  std::scoped_lock lock(latency_mutex_);
+  timestamp_list.swap(timestamp_list_);
+}
+
+}  // namespace bus
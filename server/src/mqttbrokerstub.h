@@ -0,0 +1,102 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bus {
+
+/** \brief Minimal MQTT broker that counts the received publishes.
+ *
+ * The broker is a local stand-in for a real broker in soak tests. It
+ * accepts MQTT 3.1.1 and 5 clients, acknowledges the publishes (QoS 0-2)
+ * and supports topic aliases. Nothing is forwarded to subscribers.
+ *
+ * Each publish is timestamped when it is received. If the JSON payload
+ * has a "timestamp" (nanoseconds since 1970), the end-to-end latency is
+ * calculated. This requires that the CAN frames are stamped on the same
+ * host.
+ *
+ * The acknowledges may be held back or rejected, which makes the stub
+ * usable in unit tests of the publisher.
+ */
+class MqttBrokerStub {
+ public:
+  MqttBrokerStub();
+  virtual ~MqttBrokerStub();
+
+  /** \brief Listen port. Port 0 selects a free port on Start(). */
+  void Port(uint16_t port) { port_ = port; }
+  [[nodiscard]] uint16_t Port() const { return port_; }
+
+  bool Start();
+  void Stop();
+
+  /** \brief Holds back the PUBACK/PUBREC replies until set to false. */
+  void HoldAcks(bool hold);
+  [[nodiscard]] bool HoldAcks() const { return hold_acks_; }
+
+  /** \brief Rejects the MQTT 5 publishes with an error reason code. */
+  void RejectPublishes(bool reject) { reject_publishes_ = reject; }
+  [[nodiscard]] bool RejectPublishes() const { return reject_publishes_; }
+
+  /** \brief Closes all client connections. Simulates a network failure. */
+  void DropConnections();
+
+  [[nodiscard]] uint64_t NofConnections() const { return nof_connections_; }
+  [[nodiscard]] uint64_t NofPublishes() const { return nof_publishes_; }
+  [[nodiscard]] uint64_t NofBytes() const { return nof_bytes_; }
+  /** \brief Number of publishes that only sent a topic alias. */
+  [[nodiscard]] uint64_t NofAliasPublishes() const {
+    return nof_alias_publishes_;
+  }
+  /** \brief Number of publishes with an unknown topic alias. */
+  [[nodiscard]] uint64_t NofAliasErrors() const { return nof_alias_errors_; }
+  /** \brief Last receive time in nanoseconds since 1970. */
+  [[nodiscard]] uint64_t LastPublish() const { return last_publish_; }
+
+  /** \brief Moves the latencies (ns) measured since the last call. */
+  void TakeLatencies(std::vector<int64_t>& latency_list);
+
+  /** \brief Stores the payload timestamps until they are taken. */
+  void TrackTimestamps(bool track) { track_timestamps_ = track; }
+  /** \brief Moves the payload timestamps received since the last call. */
+  void TakeTimestamps(std::vector<uint64_t>& timestamp_list);
+
+  /** \brief Called by the client sessions. */
+  void OnConnect();
+  void OnPublish(size_t nof_bytes, uint64_t timestamp, uint64_t now);
+  void OnAliasPublish(bool known_alias);
+
+ private:
+  struct Context;
+  std::unique_ptr<Context> context_;
+  uint16_t port_ = 1883;
+
+  std::thread io_thread_;
+  std::atomic<bool> hold_acks_ = false;
+  std::atomic<bool> reject_publishes_ = false;
+  std::atomic<uint64_t> nof_connections_ = 0;
+  std::atomic<uint64_t> nof_publishes_ = 0;
+  std::atomic<uint64_t> nof_bytes_ = 0;
+  std::atomic<uint64_t> nof_alias_publishes_ = 0;
+  std::atomic<uint64_t> nof_alias_errors_ = 0;
+  std::atomic<uint64_t> last_publish_ = 0;
+  std::atomic<bool> track_timestamps_ = false;
+
+  std::mutex latency_mutex_;
+  std::vector<int64_t> latency_list_;
+  std::vector<uint64_t> timestamp_list_;
+
+  void DoAccept();
+};
+
+}  // namespace bus
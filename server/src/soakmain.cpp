@@ -0,0 +1,378 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <bus/interface/businterfacefactory.h>
+#include <bus/ibusmessagequeue.h>
+
+#include "cangenerator.h"
+#include "mqttbrokerstub.h"
+
+using namespace bus;
+using namespace std::chrono;
+
+namespace {
+
+std::atomic<bool> stop_soak = false;
+
+void StopHandler(int) {
+  stop_soak = true;
+}
+
+struct SoakConfig {
+  std::string dbc_file;
+  bool shared_memory = true;
+  uint32_t bit_rate = 500'000;
+  double bus_load = 0.0;
+  uint32_t cycle_time = 100; ///< Default cycle time (ms).
+  GeneratorValues values = GeneratorValues::Ramp;
+  size_t burst_frames = 0;
+  uint32_t burst_period = 1000; ///< Burst period (ms).
+  uint16_t mqtt_port = 1883;
+  bool generator = true;
+  bool broker = true;
+  uint64_t duration = 0;  ///< Test duration (s). 0 = until Ctrl-C.
+  uint64_t report = 10;   ///< Report interval (s).
+};
+
+void PrintUsage() {
+  std::cout
+    << "Usage: can-to-mqtt-soak [options] <DBC file>\n"
+    << "  --bus shm|tcp          Bus broker type (default shm)\n"
+    << "  --bit-rate <bit/s>     CAN bit rate (default 500000)\n"
+    << "  --bus-load <%>         Target bus load 1-100 (default DBC timing)\n"
+    << "  --cycle-time <ms>      Cycle time if not in DBC (default 100)\n"
+    << "  --values ramp|random   Signal values (default ramp)\n"
+    << "  --burst <frames>:<ms>  Burst of frames each period\n"
+    << "  --mqtt-port <port>     Local MQTT broker port (default 1883)\n"
+    << "  --no-generator         Only run the MQTT broker\n"
+    << "  --no-broker            Only run the CAN generator\n"
+    << "  --duration <s>         Test duration (default until Ctrl-C)\n"
+    << "  --report <s>           Report interval (default 10)\n";
+}
+
+bool ParseArguments(int argc, char** argv, SoakConfig& config) {
+  try {
+    for (int arg = 1; arg < argc; ++arg) {
+      const std::string_view option = argv[arg];
+      const auto next = [&] () -> std::string {
+        if (arg + 1 >= argc) {
+          throw std::runtime_error("Missing value.");
+        }
+        return argv[++arg];
+      };
+      if (option == "--bus") {
+        config.shared_memory = next() != "tcp";
+      } else if (option == "--bit-rate") {
+        config.bit_rate = static_cast<uint32_t>(std::stoul(next()));
+      } else if (option == "--bus-load") {
+        config.bus_load = std::stod(next());
+      } else if (option == "--cycle-time") {
+        config.cycle_time = static_cast<uint32_t>(std::stoul(next()));
+      } else if (option == "--values") {
+        config.values = next() == "random" ? GeneratorValues::Random
+                                           : GeneratorValues::Ramp;
+      } else if (option == "--burst") {
+        const std::string burst = next();
+        const size_t colon = burst.find(':');
+        config.burst_frames = std::stoul(burst.substr(0, colon));
+        if (colon != std::string::npos) {
+          config.burst_period = static_cast<uint32_t>(
+            std::stoul(burst.substr(colon + 1)));
+        }
+        if (config.burst_period == 0) {
+          throw std::runtime_error("The burst period must be larger than 0.");
+        }
+      } else if (option == "--mqtt-port") {
+        config.mqtt_port = static_cast<uint16_t>(std::stoul(next()));
+      } else if (option == "--no-generator") {
+        config.generator = false;
+      } else if (option == "--no-broker") {
+        config.broker = false;
+      } else if (option == "--duration") {
+        config.duration = std::stoull(next());
+      } else if (option == "--report") {
+        config.report = std::max<uint64_t>(1, std::stoull(next()));
+      } else if (option.starts_with("--")) {
+        throw std::runtime_error("Unknown option: " + std::string(option));
+      } else {
+        config.dbc_file = option;
+      }
+    }
+    if (config.generator && config.dbc_file.empty()) {
+      throw std::runtime_error("No DBC file.");
+    }
+  } catch (const std::exception& err) {
+    std::cerr << "Invalid arguments. Error: " << err.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/** \brief Latency statistics in milliseconds. */
+struct LatencyStat {
+  size_t count = 0;
+  double min = 0.0;
+  double average = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+};
+
+LatencyStat CalculateLatency(std::vector<int64_t>& latency_list) {
+  LatencyStat stat;
+  if (latency_list.empty()) {
+    return stat;
+  }
+  constexpr double kToMs = 1.0e-6;
+  stat.count = latency_list.size();
+  const auto [min, max] = std::ranges::minmax(latency_list);
+  stat.min = static_cast<double>(min) * kToMs;
+  stat.max = static_cast<double>(max) * kToMs;
+  const auto sum = std::accumulate(latency_list.cbegin(), latency_list.cend(),
+                                   0.0);
+  stat.average = sum / static_cast<double>(stat.count) * kToMs;
+  const size_t p99_index = stat.count * 99 / 100;
+  std::ranges::nth_element(latency_list, latency_list.begin() + p99_index);
+  stat.p99 = static_cast<double>(latency_list[p99_index]) * kToMs;
+  return stat;
+}
+
+/** \brief Merges the interval statistics. The P99 is the worst interval. */
+void AddLatency(const LatencyStat& stat, LatencyStat& total) {
+  if (stat.count == 0) {
+    return;
+  }
+  if (total.count == 0) {
+    total = stat;
+    return;
+  }
+  const auto count = static_cast<double>(total.count + stat.count);
+  total.average = (total.average * static_cast<double>(total.count)
+                   + stat.average * static_cast<double>(stat.count)) / count;
+  total.count += stat.count;
+  total.min = std::min(total.min, stat.min);
+  total.max = std::max(total.max, stat.max);
+  total.p99 = std::max(total.p99, stat.p99);
+}
+
+/** \brief Matches the sent frames with the received payload timestamps.
+ *
+ * The generator stamps each frame with a unique timestamp, which is
+ * included in the MQTT payloads. A frame is lost if its timestamp isn't
+ * received within the grace time. Frames of a message (and mux value)
+ * are only checked after the first publish of it, so messages that
+ * aren't selected are ignored in any topic layout.
+ */
+class LossTracker {
+ public:
+  void AddFrames(const std::vector<CanGenerator::SentFrame>& frame_list) {
+    pending_list_.insert(pending_list_.end(), frame_list.cbegin(),
+                         frame_list.cend());
+  }
+
+  void AddTimestamps(const std::vector<uint64_t>& timestamp_list) {
+    received_list_.insert(timestamp_list.cbegin(), timestamp_list.cend());
+  }
+
+  /** \brief Checks the frames that were sent before the time (ns). */
+  void Check(uint64_t before) {
+    while (!pending_list_.empty()
+           && pending_list_.front().timestamp < before) {
+      const auto& frame = pending_list_.front();
+      if (received_list_.erase(frame.timestamp) > 0) {
+        seen_list_.insert(frame.key);
+        ++nof_checked_;
+      } else if (seen_list_.contains(frame.key)) {
+        ++nof_checked_;
+        ++nof_lost_;
+      }
+      pending_list_.pop_front();
+    }
+    // Drop the timestamps that don't match any frame.
+    std::erase_if(received_list_, [&] (uint64_t timestamp) {
+      return timestamp < before;
+    });
+  }
+
+  [[nodiscard]] uint64_t NofChecked() const { return nof_checked_; }
+  [[nodiscard]] uint64_t NofLost() const { return nof_lost_; }
+
+ private:
+  std::deque<CanGenerator::SentFrame> pending_list_;
+  std::unordered_set<uint64_t> received_list_;
+  std::unordered_set<uint64_t> seen_list_;
+  uint64_t nof_checked_ = 0;
+  uint64_t nof_lost_ = 0;
+};
+
+uint64_t NowNs() {
+  return static_cast<uint64_t>(duration_cast<nanoseconds>(
+    system_clock::now().time_since_epoch()).count());
+}
+
+void PrintLatency(const LatencyStat& stat) {
+  if (stat.count == 0) {
+    std::cout << ", Latency: -";
+    return;
+  }
+  std::cout << ", Latency (ms) Min: " << stat.min
+    << ", Avg: " << stat.average
+    << ", P99: " << stat.p99
+    << ", Max: " << stat.max;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  SoakConfig config;
+  if (argc < 2 || !ParseArguments(argc, argv, config)) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+  std::signal(SIGINT, StopHandler);
+  std::signal(SIGTERM, StopHandler);
+  std::cout << std::fixed << std::setprecision(3);
+
+  MqttBrokerStub broker;
+  broker.Port(config.mqtt_port);
+  broker.TrackTimestamps(config.generator);
+  if (config.broker && !broker.Start()) {
+    std::cerr << "Failed to start the MQTT broker. Port: "
+      << config.mqtt_port << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  CanGenerator generator;
+  std::unique_ptr<IBusMessageBroker> bus_broker;
+  if (config.generator) {
+    generator.BitRate(config.bit_rate);
+    generator.BusLoad(config.bus_load);
+    generator.DefaultCycleTime(milliseconds(config.cycle_time));
+    generator.Values(config.values);
+    generator.Burst(config.burst_frames, milliseconds(config.burst_period));
+    generator.TrackFrames(config.broker);
+    if (!generator.ReadDbcFile(config.dbc_file)) {
+      std::cerr << "Failed to read the DBC file. File: "
+        << config.dbc_file << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    bus_broker = BusInterfaceFactory::CreateBroker(config.shared_memory
+      ? BrokerType::SharedMemoryBrokerType : BrokerType::TcpBrokerType);
+    auto publisher = bus_broker ? bus_broker->CreatePublisher() : nullptr;
+    if (!publisher) {
+      std::cerr << "Failed to create the bus publisher." << std::endl;
+      return EXIT_FAILURE;
+    }
+    publisher->Start();
+    if (!generator.Start(publisher)) {
+      std::cerr << "Failed to start the CAN generator." << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Generating " << generator.NofMessages()
+      << " messages. Estimated bus load: " << generator.EstimatedBusLoad()
+      << "%" << std::endl;
+  }
+
+  const auto start = steady_clock::now();
+  auto last_report = start;
+  uint64_t last_frames = 0;
+  uint64_t last_publishes = 0;
+  std::vector<int64_t> latency_list;
+  LatencyStat total_latency;
+  std::vector<CanGenerator::SentFrame> frame_list;
+  std::vector<uint64_t> timestamp_list;
+  LossTracker loss;
+  const auto update_loss = [&] (uint64_t before) {
+    generator.TakeFrames(frame_list);
+    loss.AddFrames(frame_list);
+    broker.TakeTimestamps(timestamp_list);
+    loss.AddTimestamps(timestamp_list);
+    loss.Check(before);
+  };
+  // Publishes that are later than the grace time are counted as lost.
+  constexpr uint64_t kLossGrace = 5'000'000'000;
+
+  while (!stop_soak) {
+    std::this_thread::sleep_for(100ms);
+    const uint64_t now_ns = NowNs();
+    update_loss(now_ns > kLossGrace ? now_ns - kLossGrace : 0);
+    const auto now = steady_clock::now();
+    const bool done = config.duration > 0
+      && now - start >= seconds(config.duration);
+    if (!done && now - last_report < seconds(config.report)) {
+      continue;
+    }
+    const double interval = duration<double>(now - last_report).count();
+    const uint64_t frames = generator.NofFrames();
+    const uint64_t publishes = broker.NofPublishes();
+    broker.TakeLatencies(latency_list);
+    const auto latency = CalculateLatency(latency_list);
+    AddLatency(latency, total_latency);
+
+    std::cout << "Time (s): " << duration<double>(now - start).count()
+      << ", Frames/s: " << (frames - last_frames) / interval
+      << ", Publishes/s: " << (publishes - last_publishes) / interval;
+    PrintLatency(latency);
+    std::cout << std::endl;
+
+    last_report = now;
+    last_frames = frames;
+    last_publishes = publishes;
+    if (done) {
+      break;
+    }
+  }
+
+  generator.Stop();
+  // Let the last publishes arrive before the summary.
+  std::this_thread::sleep_for(1s);
+  broker.TakeLatencies(latency_list);
+  AddLatency(CalculateLatency(latency_list), total_latency);
+  update_loss(std::numeric_limits<uint64_t>::max());
+  broker.Stop();
+
+  const double elapsed = duration<double>(steady_clock::now() - start)
+    .count();
+  const uint64_t frames = generator.NofFrames();
+  const uint64_t publishes = broker.NofPublishes();
+  std::cout << "Summary. Time (s): " << elapsed
+    << ", Frames: " << frames
+    << ", Publishes: " << publishes
+    << ", Bytes: " << broker.NofBytes()
+    << ", Connections: " << broker.NofConnections() << std::endl;
+  if (config.generator && config.broker) {
+    // No timestamps are received if the payloads are compressed.
+    const uint64_t checked = loss.NofChecked();
+    if (checked == 0) {
+      std::cout << "Lost: -, ";
+    } else {
+      std::cout << "Lost: " << loss.NofLost() << " ("
+        << 100.0 * static_cast<double>(loss.NofLost())
+           / static_cast<double>(checked)
+        << "%), ";
+    }
+  }
+  std::cout << "Throughput (publishes/s): "
+    << static_cast<double>(publishes) / elapsed;
+  PrintLatency(total_latency);
+  std::cout << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -14,14 +14,22 @@
 #include <util/ixmlfile.h>
 #include <util/logstream.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <csignal>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <span>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "bus/candataframe.h"
+#include "bus/configreader.h"
 #include "bus/buslogstream.h"
+#include "bus/jsonwriter.h"
 
 using namespace std::filesystem;
 using namespace util::log;
@@ -31,16 +39,25 @@ using namespace metric;
 using namespace std::chrono_literals;
 
 namespace {
-  void SetMetricDataType(const Signal& signal, Metric& metric) {
+  void SetMetricDataType(const Signal& signal, Metric& metric,
+                         bool add_properties) {
 
     // Many signals is enumerated values.
     // The signal value is an integer that responds to a string
     // scaled value.
     const auto& enum_list = signal.EnumList();
 
-    const MetricProperty bits_prop("bits",
-      std::to_string(signal.BitLength()) );
-    metric.AddProperty(bits_prop);
+    if (add_properties) {
+      const MetricProperty bits_prop("bits",
+        std::to_string(signal.BitLength()) );
+      metric.AddProperty(bits_prop);
+    }
+
+    if (!enum_list.empty() && !add_properties) {
+      // The enum table is stored once in the compact DBC model.
+      metric.DataType(MetricType::String);
+      return;
+    }
 
     if (!enum_list.empty()) {
       std::ostringstream enum_str;
@@ -113,6 +130,74 @@ namespace {
     }
   }
 
+void AddJsonValue(std::ostringstream& json, std::string_view name,
+                  MetricType data_type, const bus::CompactDbc& dbc,
+                  const bus::CompactMessage& message,
+                  const bus::CompactSignal& signal,
+                  std::span<const uint8_t> data) {
+  bus::AddJsonString(json, name);
+  json << ":";
+  switch (data_type) {
+    case MetricType::Int8:
+    case MetricType::Int16:
+    case MetricType::Int32:
+    case MetricType::Int64: {
+      int64_t value = 0;
+      if (dbc.EngValue(message, signal, data, value)) {
+        json << value;
+      } else {
+        json << "null";
+      }
+      break;
+    }
+
+    case MetricType::UInt8:
+    case MetricType::UInt16:
+    case MetricType::UInt32:
+    case MetricType::UInt64: {
+      uint64_t value = 0;
+      if (dbc.EngValue(message, signal, data, value)) {
+        json << value;
+      } else {
+        json << "null";
+      }
+      break;
+    }
+
+    case MetricType::Float:
+    case MetricType::Double: {
+      // The default stream precision (6 digits) would truncate the value.
+      double value = 0.0;
+      if (dbc.EngValue(message, signal, data, value)) {
+        bus::AddJsonNumber(json, value);
+      } else {
+        json << "null";
+      }
+      break;
+    }
+
+    case MetricType::Boolean: {
+      bool value = false;
+      if (dbc.EngValue(message, signal, data, value)) {
+        json << (value ? "true" : "false");
+      } else {
+        json << "null";
+      }
+      break;
+    }
+
+    default: {
+      std::string value;
+      if (dbc.EngValue(message, signal, data, value)) {
+        bus::AddJsonString(json, value);
+      } else {
+        json << "null";
+      }
+      break;
+    }
+  }
+}
+
 void LogMetricToUtil(std::source_location location,
                MetricLogSeverity severity,
                const std::string& message) {
@@ -162,6 +247,7 @@ bool CanToMqtt::SaveConfigFile() const {
     SaveGeneral(root_node);
     SaveDbcFiles(root_node);
     SaveSelectedItems(root_node);
+    SaveTriggers(root_node);
     const bool write = xml_file->WriteFile();
     if (!write) {
       throw std::runtime_error("Failed to write XML file.");
@@ -182,22 +268,21 @@ bool CanToMqtt::ReadConfigFile() {
     if (!exists(config_file_)) {
       throw std::runtime_error("The config file doesn't exist.");
     }
-    auto xml_file = CreateXmlFile();
-    if (!xml_file) {
-      throw std::runtime_error("Failed to create the XML file.");
-    }
-    xml_file->FileName(config_file_);
-    const bool parse = xml_file->ParseFile();
-    if (!parse) {
+    // The config file is streamed. The selected items are added directly
+    // into a hashed selection index.
+    ConfigReader config;
+    if (const bool parse = config.ParseFile(config_file_); !parse) {
       throw std::runtime_error("Failed to parse the XML file.");
     }
-    const auto* root_node = xml_file->RootNode();
-    if (root_node == nullptr) {
-      throw std::runtime_error("Failed to get the root node.");
+    ReadGeneral(config);
+    dbc_files_ = config.DbcFiles();
+    selection_ = std::move(config.Selection());
+    capture_.Clear();
+    capture_.BufferSize(capture_buffer_size_);
+    for (const auto& trigger : config.Triggers()) {
+      capture_.AddTrigger(trigger);
     }
-    ReadGeneral(*root_node);
-    ReadDbcFiles(*root_node);
-    ReadSelectedItems(*root_node);
+    BuildRuntimeModel();
 
   } catch (std::exception &err) {
     LOG_ERROR() << "Can't read config file. File: " << config_file_
@@ -228,22 +313,22 @@ bool CanToMqtt::Start() {
     }
     bus_subscriber_->Start();
 
-    // Enable the MQTT client
-    std::ostringstream name;
-    name << broker_host_ << ":" << broker_port_;
-    mqtt_node_.Name(name.str());
-    mqtt_node_.Description("Connection to the MQTT broker.");
-    mqtt_node_.Transport(transport_layer_);
-    mqtt_node_.Host(broker_host_);
-    mqtt_node_.Port(broker_port_);
-    mqtt_node_.ClientId(broker_client_id_);
-    mqtt_node_.UserName(broker_user_);
-    mqtt_node_.Password(broker_password_);
-    mqtt_node_.Version(ProtocolVersion::Mqtt5);
-    mqtt_node_.InService();
-
-    if (const bool broker_init = mqtt_node_.Init(); !broker_init ) {
-      throw std::runtime_error("Failed to initialize the MQTT broker.");
+    // Enable the asynchronous MQTT publisher
+    CreateTopics();
+    if (const bool publisher = StartPublisher(); !publisher ) {
+      throw std::runtime_error("Failed to start the MQTT publisher.");
+    }
+    const bool capture = capture_.Start(
+      [this] (const std::string& trigger, std::string payload) {
+        PublishMessage message;
+        // The trigger name is a single topic level.
+        message.topic = topic_prefix_ + "/Capture/" + TopicLevel(trigger);
+        message.payload = std::move(payload);
+        message.content_type = "application/json";
+        publisher_.Publish(std::move(message));
+      });
+    if (!capture) {
+      throw std::runtime_error("Failed to start the event capture.");
     }
 
     stop_thread_ = false;
@@ -263,10 +348,27 @@ void CanToMqtt::Stop() {
     work_thread_.join();
   }
   LOG_TRACE() << "Stopped the working thread.";
+  capture_.Stop();
+  if (capture_.NofTriggered() > 0) {
+    LOG_INFO() << "Event capture statistics. Triggered: "
+      << capture_.NofTriggered() << ", Published: "
+      << capture_.NofPublished();
+  }
 
-  mqtt_node_.OutOfService();
-  if (const bool exit = mqtt_node_.Exit(); !exit ) {
-    LOG_TRACE() << "Failed to stop the MQTT broker.";
+  // The publisher is stopped after the working thread and the capture
+  // thread, as they are the only producers of messages. The capture
+  // thread publishes the pending captures when it stops.
+  publisher_.Stop();
+  if (publisher_.NofFailed() > 0 || publisher_.NofDropped() > 0) {
+    LOG_INFO() << "MQTT publisher statistics. Published: "
+      << publisher_.NofPublished() << ", Completed: "
+      << publisher_.NofCompleted() << ", Failed: "
+      << publisher_.NofFailed() << ", Dropped: " << publisher_.NofDropped();
+  }
+  if (const auto& compressor = publisher_.Compressor();
+      compressor.RawBytes() > 0) {
+    LOG_INFO() << "MQTT payload compression. Raw: " << compressor.RawBytes()
+      << " bytes, Compressed: " << compressor.CompressedBytes() << " bytes";
   }
 
   if (bus_subscriber_) {
@@ -279,6 +381,27 @@ void CanToMqtt::Stop() {
 
 }
 
+size_t CanToMqtt::MemoryUsage() const {
+  size_t usage = compact_dbc_.MemoryUsage();
+  // The metrics are shared pointers with a control block.
+  for (const auto& metric : metric_db_.Metrics()) {
+    usage += sizeof(metric) + 2 * sizeof(void*);
+    if (metric) {
+      usage += sizeof(*metric) + metric->Name().capacity();
+    }
+  }
+  usage += topic_list_.bucket_count() * sizeof(void*);
+  for (const auto& [ident, group_topic] : topic_list_) {
+    usage += sizeof(ident) + sizeof(group_topic) + sizeof(void*)
+           + group_topic.topic.capacity()
+           + group_topic.signal_list.capacity() * sizeof(SignalTopic);
+    for (const auto& signal_topic : group_topic.signal_list) {
+      usage += signal_topic.topic.capacity();
+    }
+  }
+  return usage;
+}
+
 void CanToMqtt::SaveGeneral(IXmlNode& root_node) const {
   if (!shared_mem_name_.empty()) {
     root_node.SetProperty("SharedMem", shared_mem_name_);
@@ -291,127 +414,125 @@ void CanToMqtt::SaveGeneral(IXmlNode& root_node) const {
   }
   root_node.SetProperty("BrokerHost", broker_host_);
   root_node.SetProperty("BrokerPort", broker_port_);
-
+  root_node.SetProperty("PublishQos", static_cast<int>(publish_qos_));
+  root_node.SetProperty("InFlightWindow", in_flight_window_);
+  root_node.SetProperty("MaxQueueSize", max_queue_size_);
+  root_node.SetProperty("TopicLayout",
+    std::string(TopicLayoutToString(topic_layout_)));
+  root_node.SetProperty("TopicPrefix", topic_prefix_);
+  if (!topic_template_.empty()) {
+    root_node.SetProperty("TopicTemplate", topic_template_);
+  }
+  root_node.SetProperty("TopicAliasMaximum", topic_alias_maximum_);
+  root_node.SetProperty("Retain", retain_);
+  root_node.SetProperty("Compression", compression_);
+  root_node.SetProperty("CompressionLevel", compression_level_);
+  if (!dictionary_file_.empty()) {
+    root_node.SetProperty("DictionaryFile", dictionary_file_);
+  }
+  root_node.SetProperty("LowLatency", low_latency_.enabled);
+  root_node.SetProperty("CpuCore", low_latency_.cpu_core);
+  root_node.SetProperty("BusyPoll", low_latency_.busy_poll);
+  root_node.SetProperty("RealTimePriority", low_latency_.realtime_priority);
+  root_node.SetProperty("LockMemory", low_latency_.lock_memory);
+  root_node.SetProperty("CaptureBufferSize", capture_buffer_size_);
 }
 
-void CanToMqtt::ReadGeneral(const IXmlNode& root_node) {
-  shared_mem_name_ =  root_node.Property<std::string>("SharedMem");
-  bus_host_ = root_node.Property<std::string>("BusHost");
-  bus_port_ =  root_node.Property<uint16_t>("BusPort");
-  broker_host_  = root_node.Property<std::string>("BrokerHost",
+void CanToMqtt::ReadGeneral(const ConfigReader& config) {
+  shared_mem_name_ =  config.Property<std::string>("SharedMem");
+  bus_host_ = config.Property<std::string>("BusHost");
+  bus_port_ =  config.Property<uint16_t>("BusPort");
+  broker_host_  = config.Property<std::string>("BrokerHost",
     "127.0.0.1");
-  broker_port_ = root_node.Property<uint16_t>("BrokerPort", 1883);
+  broker_port_ = config.Property<uint16_t>("BrokerPort", 1883);
+  const auto qos = config.Property<int>("PublishQos", 1);
+  publish_qos_ = static_cast<PublishQos>(std::clamp(qos, 0, 2));
+  in_flight_window_ = config.Property<size_t>("InFlightWindow", 256);
+  max_queue_size_ = config.Property<size_t>("MaxQueueSize", 100'000);
+  topic_layout_ = StringToTopicLayout(
+    config.Property<std::string>("TopicLayout", "Message"));
+  topic_prefix_ = config.Property<std::string>("TopicPrefix",
+    "CanMetrics");
+  topic_template_ = config.Property<std::string>("TopicTemplate");
+  topic_alias_maximum_ = config.Property<uint16_t>("TopicAliasMaximum");
+  retain_ = config.Property<bool>("Retain", false);
+  compression_ = config.Property<bool>("Compression", false);
+  compression_level_ = config.Property<int>("CompressionLevel", 3);
+  dictionary_file_ = config.Property<std::string>("DictionaryFile");
+  low_latency_ = ReadLowLatencyConfig(config);
+  capture_buffer_size_ = config.Property<size_t>("CaptureBufferSize", 4096);
 }
 
 void CanToMqtt::SaveDbcFiles(IXmlNode& root_node) const {
-  auto& node = root_node.AddNode("DbcFiles");
-  for (const auto& dbc_file : dbc_files_) {
-    if (dbc_file.Filename().empty()) {
-      continue;
-    }
-    auto& dbc_node = node.AddNode("DbcFile");
-    dbc_node.SetAttribute("name", dbc_file.Filename());
-    dbc_node.SetProperty("FileName", dbc_file.Filename());
-  }
+  ConfigReader::WriteDbcFiles(root_node, dbc_files_);
 }
 
-void CanToMqtt::ReadDbcFiles(const IXmlNode& root_node) {
-  dbc_files_.clear();
-  const auto* node = root_node.GetNode("DbcFiles");
-  if (node == nullptr) {
-    return;
+void CanToMqtt::SaveSelectedItems(IXmlNode& root_node) const {
+  auto& node = ConfigReader::WriteSelectedItems(root_node);
+  for (const auto& rule : selection_.Rules()) {
+    ConfigReader::WriteRule(node, rule);
   }
-  IXmlNode::ChildList dbc_nodes;
-  node->GetChildList(dbc_nodes);
 
-  for (const auto* dbc_node : dbc_nodes) {
-    if (dbc_node == nullptr || !dbc_node->IsTagName("DbcFiles") ) {
-      continue;
+  // The explicit selections are saved even if their DBC signal is missing,
+  // so a missing DBC file doesn't delete them from the config file.
+  for (const auto& signal : selection_.Signals()) {
+    ConfigReader::WriteMetric(node, signal.ident,
+      std::string(signal.message_name), std::string(signal.signal_name));
+  }
+}
+
+void CanToMqtt::SaveTriggers(IXmlNode& root_node) const {
+  ConfigReader::WriteTriggers(root_node, capture_.Triggers());
+}
+
+void CanToMqtt::BuildRuntimeModel() {
+  compact_dbc_.Clear();
+  capture_.ResetBindings();
+  for (auto& group : metric_db_.Groups()) {
+    if (group) {
+      group->Context(nullptr);
     }
-    auto file_name = dbc_node->Attribute<std::string>("name");
-    if (file_name.empty()) {
-      file_name = dbc_node->Property<std::string>("FileName");
+  }
+  for (auto& metric : metric_db_.Metrics()) {
+    if (metric) {
+      metric->Context(nullptr);
+      metric->Selected(false);
     }
+  }
 
+  // Single join pass between the DBC files and the selection index. The
+  // full DBC model is only needed while the compact model is built.
+  // It's released when the DbcFile object goes out of scope.
+  for (const auto& file_name : dbc_files_) {
     try {
-      if (file_name.empty()) {
-        throw std::runtime_error("File name is empty.");
-      }
       if (!exists(file_name)) {
         throw std::runtime_error("File doesn't exist.");
       }
       DbcFile dbc_file;
+      dbc_file.Filename(file_name);
       const bool parse = ParseDbcFile(dbc_file);
       if (!parse) {
         throw std::runtime_error("Failed to parse the DbcFile.");
       }
-      dbc_files_.emplace_back(std::move(dbc_file));
     } catch (const std::exception &err) {
       LOG_ERROR() << "Can't parse the DBC file. File: " << file_name
         << ", Error: " << err.what();
     }
-
   }
-}
-
-void CanToMqtt::SaveSelectedItems(IXmlNode& root_node) const {
-  auto& node = root_node.AddNode("SelectedItems");
-  for (const auto& metric : metric_db_.Metrics()) {
-    if (!metric || !metric->IsSelected()) {
-      continue;
-    }
-    auto& metric_node = node.AddNode("Metric");
-    metric_node.SetAttribute("name", metric->Name());
-    metric_node.SetAttribute("msg_id", metric->GroupIdentity());
-    metric_node.SetAttribute("msg_name", metric->GroupName());
+  compact_dbc_.Finalize();
+  LOG_INFO() << "Selection. Signals: " << selection_.NofSignals()
+    << ", Rules: " << selection_.NofRules()
+    << ", Matched Signals: " << compact_dbc_.NofSelectedSignals();
+  LOG_INFO() << "Runtime DBC model. Messages: " << compact_dbc_.NofMessages()
+    << ", Signals: " << compact_dbc_.NofSignals()
+    << ", Enum Tables: " << compact_dbc_.NofEnumTables()
+    << ", Memory: " << compact_dbc_.MemoryUsage() << " bytes";
+  for (const auto& name : capture_.UnboundSignals()) {
+    LOG_ERROR() << "The trigger signal doesn't exist. Signal: " << name;
   }
-
 }
 
-void CanToMqtt::ReadSelectedItems(const IXmlNode& root_node) {
-  // Clear any selected metrics in the database.
-  for (auto& metric : metric_db_.Metrics()) {
-    if (!metric) {
-      continue;
-    }
-    metric->Selected(false);
-  }
-
-  const auto* node = root_node.GetNode("SelectedItems");
-  if (node == nullptr) {
-    return;
-  }
-  IXmlNode::ChildList metric_nodes;
-  node->GetChildList(metric_nodes);
-
-  for (const auto* metric_node : metric_nodes) {
-    if (metric_node == nullptr || !metric_node->IsTagName("Metric") ) {
-      continue;
-    }
-    const auto name = metric_node->Attribute<std::string>("name");
-    const auto msg_id = metric_node->Attribute<int64_t>("msg_id");
-    const auto msg_name = metric_node->Attribute<std::string>("msg_name");
-
-    auto metric_group = metric_db_.CreateGroup(msg_name,
-      msg_id);
-    if (!metric_group) {
-      LOG_ERROR() << "Can't create metric group. Group: " << msg_id << ":"
-        << msg_name;
-      continue;
-    }
-
-    auto metric = metric_db_.CreateMetric(*metric_group,
-      name);
-    if (!metric) {
-      LOG_ERROR() << "The selected metric not found in the DB. Metric: "
-        << name << " (" << msg_id << ":" << msg_name << ")";
-      continue;
-    }
-    metric->Selected(true);
-  }
-}
-
-bool CanToMqtt::ParseDbcFile(DbcFile& dbc_file) const {
+bool CanToMqtt::ParseDbcFile(DbcFile& dbc_file) {
   try {
     const bool parse = dbc_file.ParseFile();
     if (!parse) {
@@ -424,40 +545,118 @@ bool CanToMqtt::ParseDbcFile(DbcFile& dbc_file) const {
     if (network == nullptr) {
       throw std::runtime_error("No network in the DBC file.");
     }
+    // Hashed, so the join with the DBC signals is linear.
+    std::unordered_set<const Signal*> selected_list;
+    std::unordered_map<const Signal*, int32_t> captured_list;
     for (const auto& [msg_id, msg] :
       network->Messages()) {
-
-      auto group = metric_db_.GetGroupByIdentity(
-        static_cast<int64_t>(msg_id));
-      if (!group) {
-        continue;
-      }
       // If the CAN message is defined in multiple DBC file, use the first
       // occurannce
-      if (group->Context() == nullptr) {
-        group->Context(&dbc_file);
-        group->Description(msg.Comment());
+      if (compact_dbc_.GetMessage(msg_id) != nullptr) {
+        continue;
+      }
+
+      const bool extended_mux = HasExtendedMux(msg);
+      selected_list.clear();
+      if (selection_.IsMessageSelected(msg_id, msg.Name(), msg.Node())) {
+        for (const auto& [signal_name, signal] : msg.Signals()) {
+          if (!selection_.IsSignalSelected(msg_id, msg.Name(), msg.Node(),
+                                           signal_name)) {
+            continue;
+          }
+          if (!IsSupportedSignal(signal, extended_mux)) {
+            LOG_WARNING() << "Extended multiplexing is not supported. "
+              << "The signal is skipped. Signal: " << signal_name
+              << " (" << msg_id << ":" << msg.Name() << ")";
+            continue;
+          }
+          selected_list.insert(&signal);
+        }
+      }
+      // Signals that are used by the event triggers are decoded even if
+      // they aren't published.
+      captured_list.clear();
+      if (!capture_.IsEmpty()) {
+        for (const auto& [signal_name, signal] : msg.Signals()) {
+          if (!IsSupportedSignal(signal, extended_mux)) {
+            continue;
+          }
+          if (const int32_t index = capture_.BindSignal(msg.Name(),
+                signal_name); index >= 0) {
+            captured_list.emplace(&signal, index);
+          }
+        }
+      }
+      if (selected_list.empty() && captured_list.empty()) {
+        continue;
       }
 
+      const auto config_name = selection_.MessageName(msg_id);
+      auto group = selected_list.empty() ? nullptr : metric_db_.CreateGroup(
+        config_name.empty() ? msg.Name() : std::string(config_name),
+        static_cast<int64_t>(msg_id));
+      if (!selected_list.empty() && !group) {
+        LOG_ERROR() << "Can't create metric group. Group: " << msg_id << ":"
+          << msg.Name();
+        continue;
+      }
 
+      // Only the selected signals and the multiplexor are copied into the
+      // compact model.
+      CompactMessage compact_msg;
+      compact_msg.ident = msg_id;
+      compact_msg.name = compact_dbc_.Strings().Intern(msg.Name());
+      compact_msg.node = compact_dbc_.Strings().Intern(msg.Node());
       for (const auto& [signal_name, signal] : msg.Signals()) {
-        auto metric = metric_db_.GetMetricByGroupIdentity(
-          group->Identity(), signal_name);
-        if (!metric) {
+        const bool selected = selected_list.contains(&signal);
+        const auto captured = captured_list.find(&signal);
+        if (!selected && captured == captured_list.cend()
+            && signal.Mux() != MuxType::Multiplexor) {
           continue;
         }
-        if (metric->Context() == nullptr) {
-          metric->Context(const_cast<Signal*>(&signal));
-          metric->Description(signal.Comment());
+        auto compact_signal = MakeCompactSignal(signal, compact_dbc_);
+        if (captured != captured_list.cend()) {
+          compact_signal.capture_index = captured->second;
+        }
+        if (selected) {
+          auto metric = metric_db_.CreateMetric(*group, signal_name);
+          if (!metric) {
+            LOG_ERROR() << "Can't create the metric. Metric: "
+              << signal_name << " (" << msg_id << ":" << msg.Name() << ")";
+            continue;
+          }
+          metric->Selected(true);
+          compact_signal.context = std::to_address(metric);
           metric->Unit(signal.Unit());
-          SetMetricDataType(signal, *metric);
-          if (signal.Min() < signal.Max()) {
-            MetricProperty min("min", std::to_string(signal.Min()));
-            metric->AddProperty(min);
-            MetricProperty max("max", std::to_string(signal.Max()));
-            metric->AddProperty(max);
+          SetMetricDataType(signal, *metric, !compact_metrics_);
+          if (!compact_metrics_) {
+            metric->Description(signal.Comment());
+            if (signal.Min() < signal.Max()) {
+              MetricProperty min("min", std::to_string(signal.Min()));
+              metric->AddProperty(min);
+              MetricProperty max("max", std::to_string(signal.Max()));
+              metric->AddProperty(max);
+            }
           }
         }
+        compact_msg.signal_list.emplace_back(compact_signal);
+      }
+
+      auto* added = compact_dbc_.AddMessage(std::move(compact_msg));
+      if (added == nullptr) {
+        continue;
+      }
+      if (group) {
+        group->Context(added);
+        if (!compact_metrics_) {
+          group->Description(msg.Comment());
+        }
+      }
+      for (auto& compact_signal : added->signal_list) {
+        if (auto* metric = static_cast<Metric*>(compact_signal.context);
+            metric != nullptr) {
+          metric->Context(&compact_signal);
+        }
       }
     }
   } catch (const std::exception& err) {
@@ -469,53 +668,67 @@ bool CanToMqtt::ParseDbcFile(DbcFile& dbc_file) const {
 }
 
 void CanToMqtt::WorkingThread() {
+  ApplyLowLatency(low_latency_);
+  const bool busy_poll = low_latency_.enabled && low_latency_.busy_poll;
+  uint32_t nof_empty_polls = 0;
+
   while (!stop_thread_) {
     if (!bus_subscriber_) {
       LOG_ERROR() << "The bus subscriber is not craeted. Invalid use.";
       break;
     }
-    std::shared_ptr<IBusMessage> msg = bus_subscriber_->PopWait(1s);
+    std::shared_ptr<IBusMessage> msg;
+    if (busy_poll) {
+      msg = bus_subscriber_->Pop();
+      if (!msg) {
+        BusyPollBackoff(nof_empty_polls++);
+        continue;
+      }
+      nof_empty_polls = 0;
+    } else {
+      msg = bus_subscriber_->PopWait(1s);
+    }
     if (!msg || msg->Type() != BusMessageType::CAN_DataFrame) {
       continue;
     }
 
     CanDataFrame can_msg(msg);
     if (const bool updated = UpdateMetrics(can_msg); updated ) {
-      // Todo: Update MQTT with changes
+      PublishMetrics(can_msg);
     }
 
   }
 }
 
 bool CanToMqtt::UpdateMetrics(const CanDataFrame& can_msg) {
-  const uint32_t msg_id = can_msg.MessageId();
-  auto metric_group = metric_db_.GetGroupByIdentity(msg_id);
-  if (!metric_group || metric_group->Context() == nullptr) {
+  const auto* message = compact_dbc_.GetMessage(can_msg.MessageId());
+  if (message == nullptr) {
     return false;
   }
+  const auto data_bytes = can_msg.DataBytes();
+  const std::span<const uint8_t> data(data_bytes.data(), data_bytes.size());
 
-  const DbcMessage dbc_msg(can_msg.Timestamp(), can_msg.CanId(),
-    can_msg.DataBytes());
-  auto* dbc_file = static_cast<DbcFile*>(metric_group->Context());
-  dbc_file->ParseMessage(dbc_msg);
-
-  // The DBC signals are updated. Update the metric value as well
-  auto metric_list =
-    metric_db_.MetricsByGroupIdentity(msg_id);
+  // Decode the selected signals and update the metric values.
   bool updated = false;
-  for (auto& metric : metric_list) {
-    if (!metric || metric->Context() == nullptr) {
+  for (const auto& signal : message->signal_list) {
+    if (signal.capture_index >= 0) {
+      if (double value = 0.0;
+          compact_dbc_.EngValue(*message, signal, data, value)) {
+        capture_.OnValue(signal.capture_index, can_msg.Timestamp(), value);
+      }
+    }
+    auto* metric = static_cast<Metric*>(signal.context);
+    if (metric == nullptr) {
       continue;
     }
-
-    const auto* dbc_signal = static_cast<Signal*>(metric->Context());
     switch (metric->DataType()) {
       case MetricType::Int8:
       case MetricType::Int16:
       case MetricType::Int32:
       case MetricType::Int64: {
         int64_t value;
-        const bool valid = dbc_signal->EngValue(value);
+        const bool valid = compact_dbc_.EngValue(*message, signal, data,
+                                                 value);
         metric->Valid(valid);
         metric->Value(value);
         break;
@@ -526,7 +739,8 @@ bool CanToMqtt::UpdateMetrics(const CanDataFrame& can_msg) {
       case MetricType::UInt32:
       case MetricType::UInt64: {
         uint64_t value;
-        const bool valid = dbc_signal->EngValue(value);
+        const bool valid = compact_dbc_.EngValue(*message, signal, data,
+                                                 value);
         metric->Valid(valid);
         metric->Value(value);
         break;
@@ -535,7 +749,8 @@ bool CanToMqtt::UpdateMetrics(const CanDataFrame& can_msg) {
       case MetricType::Float:
       case MetricType::Double: {
         double value;
-        const bool valid = dbc_signal->EngValue(value);
+        const bool valid = compact_dbc_.EngValue(*message, signal, data,
+                                                 value);
         metric->Valid(valid);
         metric->Value(value);
         break;
@@ -543,7 +758,8 @@ bool CanToMqtt::UpdateMetrics(const CanDataFrame& can_msg) {
 
       case MetricType::Boolean: {
         bool value;
-        const bool valid = dbc_signal->EngValue(value);
+        const bool valid = compact_dbc_.EngValue(*message, signal, data,
+                                                 value);
         metric->Valid(valid);
         metric->Value(value);
         break;
@@ -551,7 +767,8 @@ bool CanToMqtt::UpdateMetrics(const CanDataFrame& can_msg) {
 
       default: {
         std::string value;
-        const bool valid = dbc_signal->EngValue(value);
+        const bool valid = compact_dbc_.EngValue(*message, signal, data,
+                                                 value);
         metric->Valid(valid);
         metric->Value(value);
         break;
@@ -561,65 +778,144 @@ bool CanToMqtt::UpdateMetrics(const CanDataFrame& can_msg) {
       updated = true;
     }
   }
+  // Only the triggers with changed signals are evaluated.
+  capture_.Evaluate(can_msg.Timestamp());
   return updated;
 }
 
-bool CanToMqtt::StartMqtt() {
-  std::ostringstream name;
-  name << broker_host_ << ":" << broker_port_;
-
-  try {
-    mqtt_node_.Name(name.str());
-    mqtt_node_.Description("Connection to the MQTT broker.");
-    mqtt_node_.Transport(transport_layer_);
-    mqtt_node_.Host(broker_host_);
-    mqtt_node_.Port(broker_port_);
-    mqtt_node_.ClientId(broker_client_id_);
-    mqtt_node_.UserName(broker_user_);
-    mqtt_node_.Password(broker_password_);
-    mqtt_node_.Version(ProtocolVersion::Mqtt5);
-    mqtt_node_.InService();
-
-    // Todo: Create a better or user defined topic name
-    for (const auto& group :metric_db_.Groups()) {
-      if (!group) {
+void CanToMqtt::PublishMetrics(const CanDataFrame& can_msg) {
+  const auto itr = topic_list_.find(can_msg.MessageId());
+  if (itr == topic_list_.cend()) {
+    return;
+  }
+  const auto& group_topic = itr->second;
+  if (group_topic.message == nullptr) {
+    return;
+  }
+  const auto& message_def = *group_topic.message;
+  const auto data_bytes = can_msg.DataBytes();
+  const std::span<const uint8_t> data(data_bytes.data(), data_bytes.size());
+
+  if (group_topic.per_signal) {
+    // Only changed signals are sent. The consumers subscribe on the signals
+    // they need so the broker fans out much less data.
+    for (const auto& [metric, topic] : group_topic.signal_list) {
+      if (metric == nullptr || metric->Context() == nullptr
+          || !metric->IsUpdated()) {
         continue;
       }
-      const auto metric_list =
-        metric_db_.MetricsByGroupIdentity(group->Identity());
-      if (metric_list.empty()) {
+      const auto* signal = static_cast<const CompactSignal*>(
+        metric->Context());
+      std::ostringstream payload;
+      payload << "{\"timestamp\":" << can_msg.Timestamp() << ",";
+      AddJsonValue(payload, "value", metric->DataType(), compact_dbc_,
+        message_def, *signal, data);
+      payload << "}";
+
+      PublishMessage message;
+      message.topic = topic;
+      message.payload = payload.str();
+      message.content_type = "application/json";
+      message.retain = retain_;
+      publisher_.Publish(std::move(message));
+    }
+    return;
+  }
+
+  std::ostringstream payload;
+  payload << "{\"timestamp\":" << can_msg.Timestamp();
+  for (const auto& [metric, topic] : group_topic.signal_list) {
+    if (metric == nullptr || metric->Context() == nullptr) {
+      continue;
+    }
+    const auto* signal = static_cast<const CompactSignal*>(
+      metric->Context());
+    payload << ",";
+    AddJsonValue(payload, metric->Name(), metric->DataType(), compact_dbc_,
+      message_def, *signal, data);
+  }
+  payload << "}";
+
+  PublishMessage message;
+  message.topic = group_topic.topic;
+  message.payload = payload.str();
+  message.content_type = "application/json";
+  message.retain = retain_;
+  // The publisher never blocks. A full queue is counted as dropped.
+  publisher_.Publish(std::move(message));
+}
+
+bool CanToMqtt::StartPublisher() {
+  publisher_.Host(broker_host_);
+  publisher_.Port(broker_port_);
+  publisher_.ClientId(broker_client_id_);
+  publisher_.UserName(broker_user_);
+  publisher_.Password(broker_password_);
+  publisher_.Transport(transport_layer_);
+  publisher_.Qos(publish_qos_);
+  publisher_.InFlightWindow(in_flight_window_);
+  publisher_.MaxQueueSize(max_queue_size_);
+  publisher_.TopicAliasMaximum(topic_alias_maximum_);
+  publisher_.Compression(compression_);
+  if (compression_) {
+    auto& compressor = publisher_.Compressor();
+    compressor.Level(compression_level_);
+    if (const bool load = compressor.LoadDictionary(dictionary_file_);
+        !load) {
+      return false;
+    }
+  }
+  return publisher_.Start();
+}
+
+void CanToMqtt::CreateTopics() {
+  // The topic names are calculated once. The working thread only does a
+  // lookup on the CAN message ID.
+  topic_list_.clear();
+  const std::string topic_template = TopicTemplate(topic_layout_,
+                                                   topic_template_);
+  const bool per_signal = IsSignalTopicTemplate(topic_template);
+
+  for (const auto& group : metric_db_.Groups()) {
+    if (!group) {
+      continue;
+    }
+    const auto metric_list =
+      metric_db_.MetricsByGroupIdentity(group->Identity());
+    if (metric_list.empty()) {
+      continue;
+    }
+
+    // The DBC node (ECU) is fetched from the compact DBC message
+    const auto* message = static_cast<const CompactMessage*>(
+      group->Context());
+    if (message == nullptr) {
+      continue;
+    }
+    const std::string_view node_name = message->node;
+
+    GroupTopic group_topic;
+    group_topic.per_signal = per_signal;
+    group_topic.message = message;
+    if (!per_signal) {
+      group_topic.topic = ExpandTopicTemplate(topic_template, topic_prefix_,
+        node_name, group->Name(), group->Identity(), "");
+    }
+    for (const auto& metric : metric_list) {
+      if (!metric || metric->Name().empty()) {
         continue;
       }
-      std::ostringstream topic_name;
-      topic_name << "CanMetrics/";
-      if (group->Name().empty()) {
-        topic_name << group->Identity();
-      } else {
-        topic_name << group->Name();
-      }
-      auto mqtt_topic = mqtt_node_.CreateTopic(
-         topic_name.str());
-      if (!mqtt_topic) {
-        throw std::runtime_error("Failed to create the MQTT topic.");
-      }
-      mqtt_topic->Description("JSON coded CAN signal values.");
-      mqtt_topic->ContentType("application/json");
-      for (const auto& metric : metric_list) {
-        if (!metric || metric->Name().empty()) {
-          continue;
-        }
-        mqtt_topic->AddMetric(metric);
+      SignalTopic signal_topic;
+      signal_topic.metric = std::to_address(metric);
+      if (per_signal) {
+        signal_topic.topic = ExpandTopicTemplate(topic_template,
+          topic_prefix_, node_name, group->Name(), group->Identity(),
+          metric->Name());
       }
+      group_topic.signal_list.emplace_back(std::move(signal_topic));
     }
-    if (const bool broker_init = mqtt_node_.Init(); !broker_init ) {
-      throw std::runtime_error("Failed to initialize the MQTT broker.");
-    }
-  } catch (const std::exception& err) {
-    LOG_ERROR() << "Failed to start the MQTT broker. Name: " << name.str()
-      << ", Error: " << err.what();
-    return false;
+    topic_list_.emplace(group->Identity(), std::move(group_topic));
   }
-  return true;
 }
 
 }  // namespace bus
\ No newline at end of file
@@ -0,0 +1,472 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/compactdbc.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include <dbc/dbcfile.h>
+
+using namespace dbc;
+
+namespace {
+
+bool GetBit(std::span<const uint8_t> data, size_t bit) {
+  return (data[bit / 8] & (1U << (bit % 8))) != 0;
+}
+
+void SetBit(std::span<uint8_t> data, size_t bit, bool value) {
+  const auto mask = static_cast<uint8_t>(1U << (bit % 8));
+  if (value) {
+    data[bit / 8] |= mask;
+  } else {
+    data[bit / 8] &= static_cast<uint8_t>(~mask);
+  }
+}
+
+double ScaledValue(const bus::CompactSignal& signal, uint64_t raw) {
+  switch (signal.data_type) {
+    case bus::RawDataType::Signed:
+      return static_cast<double>(std::bit_cast<int64_t>(raw)) * signal.scale
+             + signal.offset;
+
+    case bus::RawDataType::Float:
+      return static_cast<double>(std::bit_cast<float>(
+               static_cast<uint32_t>(raw))) * signal.scale + signal.offset;
+
+    case bus::RawDataType::Double:
+      return std::bit_cast<double>(raw) * signal.scale + signal.offset;
+
+    default:
+      break;
+  }
+  return static_cast<double>(raw) * signal.scale + signal.offset;
+}
+
+/** \brief Shortest text that reads back to the same value. */
+template <typename T>
+std::string ToText(T value) {
+  std::array<char, 32> buffer {};
+  const auto [ptr, error] = std::to_chars(buffer.data(),
+    buffer.data() + buffer.size(), value);
+  return error == std::errc() ? std::string(buffer.data(), ptr)
+                              : std::string();
+}
+
+}  // namespace
+
+namespace bus {
+
+std::string_view StringArena::Intern(std::string_view text) {
+  if (text.empty()) {
+    return {};
+  }
+  if (const auto itr = index_.find(text); itr != index_.cend()) {
+    return *itr;
+  }
+  if (block_list_.empty()
+      || block_used_ + text.size() > block_size_list_.back()) {
+    const size_t block_size = std::max(kBlockSize, text.size());
+    block_list_.emplace_back(std::make_unique<char[]>(block_size));
+    block_size_list_.emplace_back(block_size);
+    block_used_ = 0;
+  }
+  char* dest = block_list_.back().get() + block_used_;
+  std::memcpy(dest, text.data(), text.size());
+  block_used_ += text.size();
+
+  const std::string_view interned(dest, text.size());
+  index_.emplace(interned);
+  return interned;
+}
+
+void StringArena::ReleaseIndex() {
+  std::unordered_set<std::string_view> temp;
+  index_.swap(temp);
+}
+
+void StringArena::Clear() {
+  ReleaseIndex();
+  block_list_.clear();
+  block_size_list_.clear();
+  block_used_ = 0;
+}
+
+size_t StringArena::MemoryUsage() const {
+  size_t usage = sizeof(StringArena);
+  for (const size_t block_size : block_size_list_) {
+    usage += block_size;
+  }
+  usage += index_.size() * (sizeof(std::string_view) + 2 * sizeof(void*));
+  return usage;
+}
+
+int32_t CompactDbc::AddEnumTable(EnumTable enum_table) {
+  if (enum_table.empty()) {
+    return -1;
+  }
+  std::ranges::sort(enum_table);
+  if (const auto itr = enum_index_.find(enum_table);
+      itr != enum_index_.cend()) {
+    return itr->second;
+  }
+  const auto index = static_cast<int32_t>(enum_list_.size());
+  enum_index_.emplace(enum_table, index);
+  enum_list_.emplace_back(std::move(enum_table));
+  return index;
+}
+
+const EnumTable* CompactDbc::GetEnumTable(int32_t index) const {
+  if (index < 0 || index >= static_cast<int32_t>(enum_list_.size())) {
+    return nullptr;
+  }
+  return &enum_list_[index];
+}
+
+CompactMessage* CompactDbc::AddMessage(CompactMessage&& message) {
+  if (message_index_.contains(message.ident)) {
+    return nullptr;
+  }
+  message.multiplexor = -1;
+  for (size_t index = 0; index < message.signal_list.size(); ++index) {
+    if (message.signal_list[index].mux == RawMuxType::Multiplexor) {
+      message.multiplexor = static_cast<int32_t>(index);
+      break;
+    }
+  }
+  message.signal_list.shrink_to_fit();
+  auto& added = message_list_.emplace_back(std::move(message));
+  message_index_.emplace(added.ident, &added);
+  return &added;
+}
+
+const CompactMessage* CompactDbc::GetMessage(uint64_t ident) const {
+  const auto itr = message_index_.find(ident);
+  return itr != message_index_.cend() ? itr->second : nullptr;
+}
+
+size_t CompactDbc::NofSignals() const {
+  size_t count = 0;
+  for (const auto& message : message_list_) {
+    count += message.signal_list.size();
+  }
+  return count;
+}
+
+size_t CompactDbc::NofSelectedSignals() const {
+  size_t count = 0;
+  for (const auto& message : message_list_) {
+    count += std::ranges::count_if(message.signal_list,
+      [] (const CompactSignal& signal) { return signal.context != nullptr; });
+  }
+  return count;
+}
+
+void CompactDbc::Finalize() {
+  strings_.ReleaseIndex();
+  enum_index_.clear();
+  enum_list_.shrink_to_fit();
+  for (auto& enum_table : enum_list_) {
+    enum_table.shrink_to_fit();
+  }
+}
+
+void CompactDbc::Clear() {
+  message_index_.clear();
+  message_list_.clear();
+  enum_index_.clear();
+  enum_list_.clear();
+  strings_.Clear();
+}
+
+size_t CompactDbc::MemoryUsage() const {
+  size_t usage = sizeof(CompactDbc) + strings_.MemoryUsage();
+  for (const auto& enum_table : enum_list_) {
+    usage += sizeof(EnumTable)
+           + enum_table.capacity() * sizeof(EnumTable::value_type);
+  }
+  usage += enum_index_.size() * (sizeof(EnumTable) + 4 * sizeof(void*));
+  for (const auto& message : message_list_) {
+    usage += sizeof(CompactMessage)
+           + message.signal_list.capacity() * sizeof(CompactSignal);
+  }
+  usage += message_index_.size()
+         * (sizeof(uint64_t) + sizeof(CompactMessage*) + 2 * sizeof(void*));
+  return usage;
+}
+
+bool CompactDbc::IsValid(const CompactMessage& message,
+                         const CompactSignal& signal,
+                         std::span<const uint8_t> data) {
+  if (signal.mux != RawMuxType::Multiplexed || message.multiplexor < 0) {
+    return true;
+  }
+  const auto& mux_signal = message.signal_list[message.multiplexor];
+  uint64_t mux_value = 0;
+  if (const bool valid = RawValue(mux_signal, data, mux_value); !valid) {
+    return false;
+  }
+  return mux_value == static_cast<uint64_t>(signal.mux_value);
+}
+
+bool CompactDbc::RawValue(const CompactSignal& signal,
+                          std::span<const uint8_t> data, uint64_t& value) {
+  value = 0;
+  if (signal.bit_length == 0 || signal.bit_length > 64) {
+    return false;
+  }
+  const size_t nof_bits = data.size() * 8;
+  if (signal.little_endian) {
+    // Intel byte order. The start bit is the LSB.
+    if (signal.start_bit + signal.bit_length > nof_bits) {
+      return false;
+    }
+    for (size_t bit = 0; bit < signal.bit_length; ++bit) {
+      if (GetBit(data, signal.start_bit + bit)) {
+        value |= 1ULL << bit;
+      }
+    }
+  } else {
+    // Motorola byte order. The start bit is the MSB and the bits are
+    // numbered in a saw-tooth pattern.
+    size_t bit = signal.start_bit;
+    for (size_t count = 0; count < signal.bit_length; ++count) {
+      if (bit >= nof_bits) {
+        return false;
+      }
+      value = (value << 1) | (GetBit(data, bit) ? 1 : 0);
+      bit = bit % 8 == 0 ? bit + 15 : bit - 1;
+    }
+  }
+
+  // Sign extension
+  if (signal.data_type == RawDataType::Signed && signal.bit_length < 64
+      && (value & (1ULL << (signal.bit_length - 1))) != 0) {
+    value |= ~0ULL << signal.bit_length;
+  }
+  return true;
+}
+
+bool CompactDbc::SetRawValue(const CompactSignal& signal,
+                             std::span<uint8_t> data, uint64_t value) {
+  if (signal.bit_length == 0 || signal.bit_length > 64) {
+    return false;
+  }
+  const size_t nof_bits = data.size() * 8;
+  if (signal.little_endian) {
+    if (signal.start_bit + signal.bit_length > nof_bits) {
+      return false;
+    }
+    for (size_t bit = 0; bit < signal.bit_length; ++bit) {
+      SetBit(data, signal.start_bit + bit, (value & (1ULL << bit)) != 0);
+    }
+  } else {
+    // Check the saw-tooth range before modifying any byte.
+    size_t bit = signal.start_bit;
+    for (size_t count = 0; count < signal.bit_length; ++count) {
+      if (bit >= nof_bits) {
+        return false;
+      }
+      bit = bit % 8 == 0 ? bit + 15 : bit - 1;
+    }
+    bit = signal.start_bit;
+    for (size_t count = signal.bit_length; count > 0; --count) {
+      SetBit(data, bit, (value & (1ULL << (count - 1))) != 0);
+      bit = bit % 8 == 0 ? bit + 15 : bit - 1;
+    }
+  }
+  return true;
+}
+
+bool CompactDbc::EngValue(const CompactMessage& message,
+                          const CompactSignal& signal,
+                          std::span<const uint8_t> data,
+                          int64_t& value) const {
+  value = 0;
+  uint64_t raw = 0;
+  if (!IsValid(message, signal, data) || !RawValue(signal, data, raw)) {
+    return false;
+  }
+  if (signal.data_type == RawDataType::Signed && signal.scale == 1.0
+      && signal.offset == 0.0) {
+    value = std::bit_cast<int64_t>(raw);
+  } else {
+    value = static_cast<int64_t>(ScaledValue(signal, raw));
+  }
+  return true;
+}
+
+bool CompactDbc::EngValue(const CompactMessage& message,
+                          const CompactSignal& signal,
+                          std::span<const uint8_t> data,
+                          uint64_t& value) const {
+  value = 0;
+  uint64_t raw = 0;
+  if (!IsValid(message, signal, data) || !RawValue(signal, data, raw)) {
+    return false;
+  }
+  if (signal.data_type == RawDataType::Unsigned && signal.scale == 1.0
+      && signal.offset == 0.0) {
+    value = raw;
+  } else {
+    value = static_cast<uint64_t>(ScaledValue(signal, raw));
+  }
+  return true;
+}
+
+bool CompactDbc::EngValue(const CompactMessage& message,
+                          const CompactSignal& signal,
+                          std::span<const uint8_t> data,
+                          double& value) const {
+  value = 0.0;
+  uint64_t raw = 0;
+  if (!IsValid(message, signal, data) || !RawValue(signal, data, raw)) {
+    return false;
+  }
+  value = ScaledValue(signal, raw);
+  return true;
+}
+
+bool CompactDbc::EngValue(const CompactMessage& message,
+                          const CompactSignal& signal,
+                          std::span<const uint8_t> data,
+                          bool& value) const {
+  uint64_t raw = 0;
+  const bool valid = EngValue(message, signal, data, raw);
+  value = raw != 0;
+  return valid;
+}
+
+bool CompactDbc::EngValue(const CompactMessage& message,
+                          const CompactSignal& signal,
+                          std::span<const uint8_t> data,
+                          std::string& value) const {
+  value.clear();
+  if (!IsValid(message, signal, data)) {
+    return false;
+  }
+
+  if (signal.bit_length > 64) {
+    // Array value. Byte aligned data bytes as a hex string.
+    const size_t first = signal.start_bit / 8;
+    const size_t last = first + (signal.bit_length + 7) / 8;
+    if (last > data.size()) {
+      return false;
+    }
+    std::ostringstream hex;
+    hex << std::hex << std::uppercase << std::setfill('0');
+    for (size_t index = first; index < last; ++index) {
+      hex << std::setw(2) << static_cast<int>(data[index]);
+    }
+    value = hex.str();
+    return true;
+  }
+
+  uint64_t raw = 0;
+  if (!RawValue(signal, data, raw)) {
+    return false;
+  }
+  if (const auto* enum_table = GetEnumTable(signal.enum_index);
+      enum_table != nullptr) {
+    const auto key = std::bit_cast<int64_t>(raw);
+    const auto itr = std::ranges::lower_bound(*enum_table, key, {},
+      &EnumTable::value_type::first);
+    if (itr != enum_table->cend() && itr->first == key) {
+      value = itr->second;
+      return true;
+    }
+  }
+
+  if (signal.scale == 1.0 && signal.offset == 0.0
+      && signal.data_type == RawDataType::Unsigned) {
+    value = ToText(raw);
+  } else if (signal.scale == 1.0 && signal.offset == 0.0
+      && signal.data_type == RawDataType::Signed) {
+    value = ToText(std::bit_cast<int64_t>(raw));
+  } else {
+    value = ToText(ScaledValue(signal, raw));
+  }
+  return true;
+}
+
+CompactSignal MakeCompactSignal(const Signal& signal, CompactDbc& dbc) {
+  auto& strings = dbc.Strings();
+  CompactSignal compact;
+  compact.name = strings.Intern(signal.Name());
+  compact.unit = strings.Intern(signal.Unit());
+  compact.scale = signal.Scale();
+  compact.offset = signal.Offset();
+  compact.start_bit = static_cast<uint16_t>(signal.BitStart());
+  compact.bit_length = static_cast<uint16_t>(signal.BitLength());
+  compact.little_endian = signal.LittleEndian();
+  switch (signal.DataType()) {
+    case SignalDataType::SignedData:
+      compact.data_type = RawDataType::Signed;
+      break;
+
+    case SignalDataType::FloatData:
+      compact.data_type = RawDataType::Float;
+      break;
+
+    case SignalDataType::DoubleData:
+      compact.data_type = RawDataType::Double;
+      break;
+
+    default:
+      compact.data_type = RawDataType::Unsigned;
+      break;
+  }
+  switch (signal.Mux()) {
+    case MuxType::Multiplexor:
+      compact.mux = RawMuxType::Multiplexor;
+      break;
+
+    case MuxType::Multiplexed:
+      compact.mux = RawMuxType::Multiplexed;
+      compact.mux_value = static_cast<int32_t>(signal.MuxValue());
+      break;
+
+    default:
+      // Extended multiplexors are filtered by IsSupportedSignal().
+      break;
+  }
+
+  if (const auto& enum_list = signal.EnumList(); !enum_list.empty()) {
+    EnumTable enum_table;
+    enum_table.reserve(enum_list.size());
+    for (const auto& [key, text] : enum_list) {
+      enum_table.emplace_back(static_cast<int64_t>(key), strings.Intern(text));
+    }
+    compact.enum_index = dbc.AddEnumTable(std::move(enum_table));
+  }
+  return compact;
+}
+
+bool HasExtendedMux(const Message& message) {
+  return std::ranges::any_of(message.Signals(), [] (const auto& item) {
+    return item.second.Mux() == MuxType::ExtendedMultiplexor;
+  });
+}
+
+bool IsSupportedSignal(const Signal& signal, bool extended_mux) {
+  switch (signal.Mux()) {
+    case MuxType::ExtendedMultiplexor:
+      return false;
+
+    case MuxType::Multiplexed:
+      return !extended_mux;
+
+    default:
+      return true;
+  }
+}
+
+}  // namespace bus
@@ -0,0 +1,381 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/configreader.h"
+
+#include <util/logstream.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include <expat.h>
+
+using namespace util::log;
+using namespace util::xml;
+
+namespace {
+
+constexpr size_t kBufferSize = 64 * 1024;
+
+// The config file schema. Shared by the reader and the writer.
+constexpr std::string_view kDbcFiles = "DbcFiles";
+constexpr std::string_view kDbcFile = "DbcFile";
+constexpr std::string_view kFileName = "FileName";
+constexpr std::string_view kSelectedItems = "SelectedItems";
+constexpr std::string_view kMetric = "Metric";
+constexpr std::string_view kRule = "Rule";
+constexpr std::string_view kTriggers = "Triggers";
+constexpr std::string_view kTrigger = "Trigger";
+
+constexpr const char* kName = "name";
+constexpr const char* kMsgId = "msg_id";
+constexpr const char* kMsgName = "msg_name";
+constexpr const char* kMinId = "min_id";
+constexpr const char* kMaxId = "max_id";
+constexpr const char* kNode = "node";
+constexpr const char* kMessage = "message";
+constexpr const char* kSignal = "signal";
+constexpr const char* kCondition = "condition";
+constexpr const char* kPre = "pre";
+constexpr const char* kPost = "post";
+constexpr const char* kSignals = "signals";
+
+void XMLCALL StartElementHandler(void* user_data, const XML_Char* name,
+                                 const XML_Char** attributes) {
+  auto* reader = static_cast<bus::ConfigReader*>(user_data);
+  if (reader != nullptr) {
+    reader->OnStartElement(name, attributes);
+  }
+}
+
+void XMLCALL EndElementHandler(void* user_data, const XML_Char* name) {
+  auto* reader = static_cast<bus::ConfigReader*>(user_data);
+  if (reader != nullptr) {
+    reader->OnEndElement(name);
+  }
+}
+
+void XMLCALL CharacterDataHandler(void* user_data, const XML_Char* data,
+                                  int length) {
+  auto* reader = static_cast<bus::ConfigReader*>(user_data);
+  if (reader != nullptr) {
+    reader->OnCharacterData(data, length);
+  }
+}
+
+const char* GetAttribute(const char** attributes, const char* key) {
+  for (size_t index = 0; attributes != nullptr && attributes[index] != nullptr;
+       index += 2) {
+    if (std::strcmp(attributes[index], key) == 0) {
+      return attributes[index + 1];
+    }
+  }
+  return nullptr;
+}
+
+std::string_view AttributeText(const char** attributes, const char* key) {
+  const char* value = GetAttribute(attributes, key);
+  return value != nullptr ? std::string_view(value) : std::string_view();
+}
+
+/** Reads decimal or hexadecimal (0x) numbers. */
+bool AttributeNumber(const char** attributes, const char* key,
+                     uint64_t& value) {
+  const char* text = GetAttribute(attributes, key);
+  if (text == nullptr || *text == '\0') {
+    return false;
+  }
+  try {
+    value = std::stoull(text, nullptr, 0);
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+bool AttributeNumber(const char** attributes, const char* key,
+                     double& value) {
+  const char* text = GetAttribute(attributes, key);
+  if (text == nullptr || *text == '\0') {
+    return false;
+  }
+  try {
+    value = std::stod(text);
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+std::string Trim(std::string_view text) {
+  const auto first = text.find_first_not_of(" \t\r\n");
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  const auto last = text.find_last_not_of(" \t\r\n");
+  return std::string(text.substr(first, last - first + 1));
+}
+
+/** Splits a comma separated list. */
+std::vector<std::string> SplitList(std::string_view text) {
+  std::vector<std::string> list;
+  size_t start = 0;
+  while (start <= text.size()) {
+    const size_t end = text.find(',', start);
+    auto item = Trim(text.substr(start, end == std::string_view::npos
+      ? std::string_view::npos : end - start));
+    if (!item.empty()) {
+      list.emplace_back(std::move(item));
+    }
+    if (end == std::string_view::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+  return list;
+}
+
+struct ParserDeleter {
+  void operator()(XML_Parser parser) const { XML_ParserFree(parser); }
+};
+
+}  // namespace
+
+namespace bus {
+
+template <>
+std::string ConfigReader::Property(const std::string& key,
+                                   const std::string& def) const {
+  const auto itr = property_list_.find(key);
+  return itr == property_list_.cend() ? def : itr->second;
+}
+
+template <>
+bool ConfigReader::Property(const std::string& key, const bool& def) const {
+  const auto itr = property_list_.find(key);
+  if (itr == property_list_.cend() || itr->second.empty()) {
+    return def;
+  }
+  switch (std::toupper(static_cast<unsigned char>(itr->second.front()))) {
+    case '1':
+    case 'T':
+    case 'Y':
+      return true;
+
+    case '0':
+    case 'F':
+    case 'N':
+      return false;
+
+    default:
+      break;
+  }
+  return def;
+}
+
+bool ConfigReader::ParseFile(const std::string& filename) {
+  property_list_.clear();
+  dbc_file_list_.clear();
+  selection_.Clear();
+  trigger_list_.clear();
+  last_error_.clear();
+  section_ = Section::None;
+  level_ = 0;
+
+  try {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open the file.");
+    }
+    std::unique_ptr<XML_ParserStruct, ParserDeleter> parser(
+      XML_ParserCreate(nullptr));
+    if (!parser) {
+      throw std::runtime_error("Failed to create the XML parser.");
+    }
+    XML_SetUserData(parser.get(), this);
+    XML_SetElementHandler(parser.get(), StartElementHandler,
+                          EndElementHandler);
+    XML_SetCharacterDataHandler(parser.get(), CharacterDataHandler);
+
+    std::array<char, kBufferSize> buffer {};
+    bool final = false;
+    while (!final) {
+      file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      const auto size = static_cast<int>(file.gcount());
+      final = file.eof() || size == 0;
+      if (XML_Parse(parser.get(), buffer.data(), size, final ? 1 : 0)
+          == XML_STATUS_ERROR) {
+        std::ostringstream err;
+        err << XML_ErrorString(XML_GetErrorCode(parser.get()))
+            << " Line: " << XML_GetCurrentLineNumber(parser.get());
+        throw std::runtime_error(err.str());
+      }
+    }
+  } catch (const std::exception& err) {
+    last_error_ = err.what();
+    LOG_ERROR() << "Failed to parse the config file. File: " << filename
+      << ", Error: " << err.what();
+    return false;
+  }
+  return true;
+}
+
+void ConfigReader::OnStartElement(const char* name, const char** attributes) {
+  ++level_;
+  text_.clear();
+  element_ = name;
+
+  switch (level_) {
+    case 1: // Root node
+      break;
+
+    case 2:
+      if (element_ == kDbcFiles) {
+        section_ = Section::DbcFiles;
+      } else if (element_ == kSelectedItems) {
+        section_ = Section::SelectedItems;
+      } else if (element_ == kTriggers) {
+        section_ = Section::Triggers;
+      } else {
+        section_ = Section::General;
+      }
+      break;
+
+    case 3:
+      if (section_ == Section::DbcFiles && element_ == kDbcFile) {
+        if (const auto file_name = AttributeText(attributes, kName);
+            !file_name.empty()) {
+          dbc_file_list_.emplace_back(file_name);
+        }
+      } else if (section_ == Section::SelectedItems
+                 && element_ == kMetric) {
+        uint64_t ident = 0;
+        const auto signal_name = AttributeText(attributes, kName);
+        if (AttributeNumber(attributes, kMsgId, ident)
+            && !signal_name.empty()) {
+          selection_.AddSignal(ident, AttributeText(attributes, kMsgName),
+                               signal_name);
+        }
+      } else if (section_ == Section::SelectedItems && element_ == kRule) {
+        SelectionRule rule;
+        AttributeNumber(attributes, kMinId, rule.min_ident);
+        AttributeNumber(attributes, kMaxId, rule.max_ident);
+        rule.node = GlobPattern(AttributeText(attributes, kNode));
+        rule.message = GlobPattern(AttributeText(attributes, kMessage));
+        rule.signal = GlobPattern(AttributeText(attributes, kSignal));
+        selection_.AddRule(std::move(rule));
+      } else if (section_ == Section::Triggers && element_ == kTrigger) {
+        TriggerConfig trigger;
+        trigger.name = AttributeText(attributes, kName);
+        trigger.condition = AttributeText(attributes, kCondition);
+        AttributeNumber(attributes, kPre, trigger.pre_time);
+        AttributeNumber(attributes, kPost, trigger.post_time);
+        trigger.signal_list = SplitList(AttributeText(attributes, kSignals));
+        if (!trigger.name.empty() && !trigger.condition.empty()) {
+          trigger_list_.emplace_back(std::move(trigger));
+        }
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void ConfigReader::OnEndElement(const char* name) {
+  if (level_ == 2 && section_ == Section::General) {
+    property_list_[name] = Trim(text_);
+  } else if (level_ == 4 && section_ == Section::DbcFiles
+             && kFileName == name) {
+    // Older files may only have the file name as a property.
+    if (auto file_name = Trim(text_);
+        !file_name.empty()
+        && std::ranges::find(dbc_file_list_, file_name)
+           == dbc_file_list_.cend()) {
+      dbc_file_list_.emplace_back(std::move(file_name));
+    }
+  }
+  if (level_ == 2) {
+    section_ = Section::None;
+  }
+  text_.clear();
+  --level_;
+}
+
+void ConfigReader::OnCharacterData(const char* data, int length) {
+  // Only property values have text. The selected items may be many, so
+  // their white space is not stored.
+  if ((section_ == Section::General && level_ == 2)
+      || (section_ == Section::DbcFiles && level_ == 4)) {
+    text_.append(data, static_cast<size_t>(length));
+  }
+}
+
+void ConfigReader::WriteDbcFiles(IXmlNode& root_node,
+    const std::vector<std::string>& dbc_file_list) {
+  auto& node = root_node.AddNode(std::string(kDbcFiles));
+  for (const auto& dbc_file : dbc_file_list) {
+    if (dbc_file.empty()) {
+      continue;
+    }
+    auto& dbc_node = node.AddNode(std::string(kDbcFile));
+    dbc_node.SetAttribute(kName, dbc_file);
+    dbc_node.SetProperty(std::string(kFileName), dbc_file);
+  }
+}
+
+IXmlNode& ConfigReader::WriteSelectedItems(IXmlNode& root_node) {
+  return root_node.AddNode(std::string(kSelectedItems));
+}
+
+void ConfigReader::WriteRule(IXmlNode& items_node,
+                             const SelectionRule& rule) {
+  auto& rule_node = items_node.AddNode(std::string(kRule));
+  rule_node.SetAttribute(kMinId, rule.min_ident);
+  rule_node.SetAttribute(kMaxId, rule.max_ident);
+  rule_node.SetAttribute(kNode, rule.node.Pattern());
+  rule_node.SetAttribute(kMessage, rule.message.Pattern());
+  rule_node.SetAttribute(kSignal, rule.signal.Pattern());
+}
+
+void ConfigReader::WriteMetric(IXmlNode& items_node, uint64_t msg_id,
+                               const std::string& msg_name,
+                               const std::string& signal_name) {
+  auto& metric_node = items_node.AddNode(std::string(kMetric));
+  metric_node.SetAttribute(kName, signal_name);
+  metric_node.SetAttribute(kMsgId, msg_id);
+  metric_node.SetAttribute(kMsgName, msg_name);
+}
+
+void ConfigReader::WriteTriggers(IXmlNode& root_node,
+    const std::vector<TriggerConfig>& trigger_list) {
+  if (trigger_list.empty()) {
+    return;
+  }
+  auto& node = root_node.AddNode(std::string(kTriggers));
+  for (const auto& trigger : trigger_list) {
+    auto& trigger_node = node.AddNode(std::string(kTrigger));
+    trigger_node.SetAttribute(kName, trigger.name);
+    trigger_node.SetAttribute(kCondition, trigger.condition);
+    trigger_node.SetAttribute(kPre, trigger.pre_time);
+    trigger_node.SetAttribute(kPost, trigger.post_time);
+    std::string signals;
+    for (const auto& signal : trigger.signal_list) {
+      if (!signals.empty()) {
+        signals += ",";
+      }
+      signals += signal;
+    }
+    if (!signals.empty()) {
+      trigger_node.SetAttribute(kSignals, signals);
+    }
+  }
+}
+
+}  // namespace bus
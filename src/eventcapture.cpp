@@ -0,0 +1,375 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/eventcapture.h"
+
+#include <util/logstream.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "bus/jsonwriter.h"
+
+using namespace util::log;
+using namespace std::chrono;
+
+namespace {
+
+/// Extra wait for late frames before a capture is completed by the timer.
+constexpr auto kQuietTime = seconds(1);
+
+uint64_t ToNs(double seconds) {
+  return seconds > 0.0 ? static_cast<uint64_t>(seconds * 1'000'000'000.0)
+                       : 0;
+}
+
+}  // namespace
+
+namespace bus {
+
+EventCapture::~EventCapture() {
+  EventCapture::Stop();
+}
+
+int32_t EventCapture::AddSignalName(std::string_view name) {
+  const std::string key(name);
+  if (const auto itr = signal_index_.find(key); itr != signal_index_.cend()) {
+    return itr->second;
+  }
+  const auto index = static_cast<int32_t>(signal_list_.size());
+  auto& signal = signal_list_.emplace_back();
+  signal.name = key;
+  signal_index_.emplace(key, index);
+  return index;
+}
+
+bool EventCapture::AddTrigger(const TriggerConfig& config) {
+  const size_t nof_signals = signal_list_.size();
+  Trigger trigger;
+  trigger.config = config;
+  const bool compiled = trigger.expression.Compile(config.condition,
+    [this] (std::string_view name) { return AddSignalName(name); });
+  if (!compiled || trigger.expression.IsEmpty()) {
+    // Remove the signal names that the failed expression added.
+    for (size_t index = nof_signals; index < signal_list_.size(); ++index) {
+      signal_index_.erase(signal_list_[index].name);
+    }
+    signal_list_.resize(nof_signals);
+    LOG_ERROR() << "Invalid trigger condition. Trigger: " << config.name
+      << ", Error: " << trigger.expression.LastError();
+    return false;
+  }
+
+  if (config.signal_list.empty()) {
+    trigger.capture_list = trigger.expression.Signals();
+  } else {
+    for (const auto& name : config.signal_list) {
+      trigger.capture_list.push_back(AddSignalName(name));
+    }
+  }
+
+  const size_t trigger_index = trigger_list_.size();
+  for (const int32_t index : trigger.expression.Signals()) {
+    signal_list_[index].trigger_list.push_back(trigger_index);
+  }
+  trigger_list_.emplace_back(std::move(trigger));
+  return true;
+}
+
+std::vector<TriggerConfig> EventCapture::Triggers() const {
+  std::vector<TriggerConfig> config_list;
+  config_list.reserve(trigger_list_.size());
+  for (const auto& trigger : trigger_list_) {
+    config_list.push_back(trigger.config);
+  }
+  return config_list;
+}
+
+void EventCapture::Clear() {
+  Stop();
+  trigger_list_.clear();
+  signal_list_.clear();
+  signal_index_.clear();
+}
+
+int32_t EventCapture::BindSignal(std::string_view message_name,
+                                 std::string_view signal_name) {
+  if (signal_index_.empty()) {
+    return -1;
+  }
+  std::string key(message_name);
+  key += '.';
+  key += signal_name;
+  auto itr = signal_index_.find(key);
+  if (itr == signal_index_.cend()) {
+    itr = signal_index_.find(std::string(signal_name));
+  }
+  if (itr == signal_index_.cend()) {
+    return -1;
+  }
+  auto& signal = signal_list_[itr->second];
+  if (signal.bound) {
+    return -1;
+  }
+  signal.bound = true;
+  return itr->second;
+}
+
+void EventCapture::ResetBindings() {
+  for (auto& signal : signal_list_) {
+    signal.bound = false;
+  }
+}
+
+std::vector<std::string> EventCapture::UnboundSignals() const {
+  std::vector<std::string> name_list;
+  for (const auto& signal : signal_list_) {
+    if (!signal.bound) {
+      name_list.push_back(signal.name);
+    }
+  }
+  return name_list;
+}
+
+bool EventCapture::Start(PublishFunction publish) {
+  Stop();
+  if (trigger_list_.empty()) {
+    return true;
+  }
+  if (!publish) {
+    LOG_ERROR() << "No publish function. Invalid use of function.";
+    return false;
+  }
+  publish_ = std::move(publish);
+  for (auto& signal : signal_list_) {
+    signal.buffer = std::make_unique<SignalRingBuffer>(buffer_size_);
+  }
+  value_list_.assign(signal_list_.size(), 0.0);
+  valid_list_.assign(signal_list_.size(), 0);
+  dirty_list_.clear();
+  pending_list_.clear();
+  nof_pending_ = 0;
+  for (auto& trigger : trigger_list_) {
+    trigger.dirty = false;
+    trigger.active = false;
+  }
+  stop_thread_ = false;
+  capture_thread_ = std::thread(&EventCapture::CaptureThread, this);
+  return true;
+}
+
+void EventCapture::Stop() {
+  {
+    // The capture thread publishes the pending captures before it ends.
+    std::scoped_lock lock(capture_mutex_);
+    stop_thread_ = true;
+  }
+  capture_condition_.notify_all();
+  if (capture_thread_.joinable()) {
+    capture_thread_.join();
+  }
+  std::scoped_lock lock(capture_mutex_);
+  pending_list_.clear();
+  nof_pending_ = 0;
+  capture_queue_.clear();
+}
+
+void EventCapture::OnValue(int32_t index, uint64_t timestamp, double value) {
+  if (index < 0 || static_cast<size_t>(index) >= value_list_.size()) {
+    return;
+  }
+  auto& signal = signal_list_[index];
+  signal.buffer->Push(timestamp, value);
+  if (valid_list_[index] != 0 && value_list_[index] == value) {
+    return;
+  }
+  value_list_[index] = value;
+  valid_list_[index] = 1;
+  for (const size_t trigger_index : signal.trigger_list) {
+    if (auto& trigger = trigger_list_[trigger_index]; !trigger.dirty) {
+      trigger.dirty = true;
+      dirty_list_.push_back(trigger_index);
+    }
+  }
+}
+
+void EventCapture::Evaluate(uint64_t timestamp) {
+  if (dirty_list_.empty() && nof_pending_ == 0) {
+    return;
+  }
+
+  for (const size_t trigger_index : dirty_list_) {
+    auto& trigger = trigger_list_[trigger_index];
+    trigger.dirty = false;
+    // All signals need a value before the condition is valid.
+    const auto& index_list = trigger.expression.Signals();
+    if (!std::ranges::all_of(index_list, [&] (int32_t index) {
+          return valid_list_[index] != 0;
+        })) {
+      continue;
+    }
+    const bool active = trigger.expression.IsTrue(value_list_);
+    // Only a rising edge triggers.
+    if (active && !trigger.active) {
+      StartCapture(trigger_index, timestamp);
+    }
+    trigger.active = active;
+  }
+  dirty_list_.clear();
+
+  if (nof_pending_ == 0) {
+    return;
+  }
+  bool completed = false;
+  {
+    std::scoped_lock lock(capture_mutex_);
+    completed = CompleteCaptures(timestamp, steady_clock::time_point::min());
+  }
+  if (completed) {
+    capture_condition_.notify_one();
+  }
+}
+
+void EventCapture::StartCapture(size_t trigger_index, uint64_t timestamp) {
+  const auto& config = trigger_list_[trigger_index].config;
+  Capture capture;
+  capture.trigger = trigger_index;
+  capture.trigger_time = timestamp;
+  const uint64_t pre_time = ToNs(config.pre_time);
+  capture.start_time = timestamp > pre_time ? timestamp - pre_time : 0;
+  const uint64_t post_time = ToNs(config.post_time);
+  capture.end_time = timestamp + post_time;
+  capture.deadline = steady_clock::now() + nanoseconds(post_time)
+                   + kQuietTime;
+
+  std::scoped_lock lock(capture_mutex_);
+  // A new trigger is ignored while the capture is waiting for its
+  // post-trigger samples.
+  if (std::ranges::any_of(pending_list_, [&] (const Capture& pending) {
+        return pending.trigger == trigger_index;
+      })) {
+    return;
+  }
+  pending_list_.push_back(capture);
+  nof_pending_ = pending_list_.size();
+  ++nof_triggered_;
+  // The capture thread waits for the new deadline.
+  capture_condition_.notify_one();
+}
+
+bool EventCapture::CompleteCaptures(uint64_t timestamp,
+                                    steady_clock::time_point now) {
+  const auto itr = std::stable_partition(pending_list_.begin(),
+    pending_list_.end(), [&] (const Capture& capture) {
+      return capture.end_time > timestamp && capture.deadline > now;
+    });
+  if (itr == pending_list_.end()) {
+    return false;
+  }
+  capture_queue_.insert(capture_queue_.end(), itr, pending_list_.end());
+  pending_list_.erase(itr, pending_list_.end());
+  nof_pending_ = pending_list_.size();
+  return true;
+}
+
+void EventCapture::CaptureThread() {
+  while (true) {
+    Capture capture;
+    {
+      std::unique_lock lock(capture_mutex_);
+      // A new pending capture may have an earlier deadline.
+      const size_t nof_pending = pending_list_.size();
+      const auto ready = [&] {
+        return stop_thread_ || !capture_queue_.empty()
+          || pending_list_.size() > nof_pending;
+      };
+      if (pending_list_.empty()) {
+        capture_condition_.wait(lock, ready);
+      } else {
+        // Completes the captures if the bus is quiet.
+        const auto deadline = std::ranges::min(pending_list_, {},
+          &Capture::deadline).deadline;
+        capture_condition_.wait_until(lock, deadline, ready);
+      }
+      if (stop_thread_) {
+        CompleteCaptures(std::numeric_limits<uint64_t>::max(),
+                         steady_clock::time_point::max());
+      } else {
+        CompleteCaptures(0, steady_clock::now());
+      }
+      if (capture_queue_.empty()) {
+        if (stop_thread_) {
+          break;
+        }
+        continue;
+      }
+      capture = capture_queue_.front();
+      capture_queue_.pop_front();
+    }
+    try {
+      publish_(trigger_list_[capture.trigger].config.name,
+               MakePayload(capture));
+      ++nof_published_;
+    } catch (const std::exception& err) {
+      LOG_ERROR() << "Failed to publish the capture. Trigger: "
+        << trigger_list_[capture.trigger].config.name
+        << ", Error: " << err.what();
+    }
+  }
+}
+
+std::string EventCapture::MakePayload(const Capture& capture) const {
+  const auto& trigger = trigger_list_[capture.trigger];
+  std::string json;
+  json.reserve(1024);
+  json += "{\"trigger\":";
+  AddJsonString(json, trigger.config.name);
+  json += ",\"condition\":";
+  AddJsonString(json, trigger.config.condition);
+  json += ",\"timestamp\":";
+  AddJsonNumber(json, capture.trigger_time);
+  json += ",\"start\":";
+  AddJsonNumber(json, capture.start_time);
+  json += ",\"end\":";
+  AddJsonNumber(json, capture.end_time);
+  json += ",\"signals\":{";
+
+  // The samples are stored as columns, which compress better.
+  std::vector<SignalSample> sample_list;
+  bool first_signal = true;
+  for (const int32_t index : trigger.capture_list) {
+    const auto& signal = signal_list_[index];
+    if (!signal.buffer) {
+      continue;
+    }
+    sample_list.clear();
+    signal.buffer->Snapshot(capture.start_time, capture.end_time,
+                            sample_list);
+    if (!first_signal) {
+      json += ',';
+    }
+    first_signal = false;
+    AddJsonString(json, signal.name);
+    json += ":{\"timestamps\":[";
+    for (size_t sample = 0; sample < sample_list.size(); ++sample) {
+      if (sample > 0) {
+        json += ',';
+      }
+      AddJsonNumber(json, sample_list[sample].timestamp);
+    }
+    json += "],\"values\":[";
+    for (size_t sample = 0; sample < sample_list.size(); ++sample) {
+      if (sample > 0) {
+        json += ',';
+      }
+      AddJsonNumber(json, sample_list[sample].value);
+    }
+    json += "]}";
+  }
+  json += "}}";
+  return json;
+}
+
+}  // namespace bus
@@ -0,0 +1,83 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/jsonwriter.h"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+template <typename T>
+void AddNumber(std::string& json, T value) {
+  std::array<char, 32> buffer {};
+  const auto [ptr, error] = std::to_chars(buffer.data(),
+    buffer.data() + buffer.size(), value);
+  if (error != std::errc()) {
+    json += "null";
+    return;
+  }
+  json.append(buffer.data(), ptr);
+}
+
+}  // namespace
+
+namespace bus {
+
+void AddJsonString(std::string& json, std::string_view text) {
+  constexpr std::string_view kHex = "0123456789abcdef";
+  json += '"';
+  for (const char in_char : text) {
+    switch (in_char) {
+      case '"': json += "\\\""; break;
+      case '\\': json += "\\\\"; break;
+      case '\b': json += "\\b"; break;
+      case '\f': json += "\\f"; break;
+      case '\n': json += "\\n"; break;
+      case '\r': json += "\\r"; break;
+      case '\t': json += "\\t"; break;
+      default: {
+        const auto code = static_cast<unsigned char>(in_char);
+        if (code < 0x20) {
+          json += "\\u00";
+          json += kHex[code >> 4];
+          json += kHex[code & 0x0F];
+        } else {
+          json += in_char;
+        }
+        break;
+      }
+    }
+  }
+  json += '"';
+}
+
+void AddJsonString(std::ostream& json, std::string_view text) {
+  std::string quoted;
+  quoted.reserve(text.size() + 2);
+  AddJsonString(quoted, text);
+  json << quoted;
+}
+
+void AddJsonNumber(std::string& json, double value) {
+  if (!std::isfinite(value)) {
+    json += "null";
+    return;
+  }
+  AddNumber(json, value);
+}
+
+void AddJsonNumber(std::string& json, uint64_t value) {
+  AddNumber(json, value);
+}
+
+void AddJsonNumber(std::ostream& json, double value) {
+  std::string number;
+  AddJsonNumber(number, value);
+  json << number;
+}
+
+}  // namespace bus
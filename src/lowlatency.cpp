@@ -0,0 +1,182 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/lowlatency.h"
+
+#include <util/logstream.h>
+
+#include "bus/configreader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+using namespace util::log;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Number of empty polls that only spin before the thread starts to yield.
+constexpr uint32_t kSpinPolls = 64;
+// Number of empty polls that yield before the thread starts to sleep.
+constexpr uint32_t kYieldPolls = 64;
+// The sleep is doubled every kYieldPolls from kMinSleep up to kMaxSleep.
+constexpr auto kMinSleep = 50us;
+constexpr auto kMaxSleep = 1000us;
+// Max number of pause instructions in one backoff.
+constexpr uint32_t kMaxPauses = 32;
+// Stack size that is pre-faulted when the memory is locked.
+constexpr size_t kPreFaultStack = 256 * 1024;
+
+void CpuPause() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+bool PinToCore(int cpu_core) {
+#if defined(_WIN32)
+  if (cpu_core >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+    return false;
+  }
+  const auto mask = static_cast<DWORD_PTR>(1) << cpu_core;
+  return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+  if (cpu_core >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu_core, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set),
+                                &cpu_set) == 0;
+#endif
+}
+
+bool SetRealTimePriority(int priority) {
+#if defined(_WIN32)
+  return SetThreadPriority(GetCurrentThread(),
+                           THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+  sched_param param {};
+  param.sched_priority = std::clamp(priority,
+    sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+  return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+}
+
+bool LockMemory() {
+#if defined(_WIN32)
+  // Windows has no mlockall() equivalent. Only the stack is pre-faulted.
+  return false;
+#else
+  return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#endif
+}
+
+void PreFaultStack() {
+  // Touch the stack, so its pages are mapped before the thread runs.
+  [[maybe_unused]] volatile char stack[kPreFaultStack];
+  for (size_t index = 0; index < kPreFaultStack; index += 4096) {
+    stack[index] = 0;
+  }
+}
+
+}  // namespace
+
+namespace bus {
+
+LowLatencyConfig ReadLowLatencyConfig(const ConfigReader& config) {
+  LowLatencyConfig low_latency;
+  low_latency.enabled = config.Property<bool>("LowLatency", false);
+  low_latency.cpu_core = std::max(config.Property<int>("CpuCore", -1), -1);
+  low_latency.busy_poll = config.Property<bool>("BusyPoll", false);
+  low_latency.realtime_priority = std::clamp(
+    config.Property<int>("RealTimePriority", 0), 0, 99);
+  low_latency.lock_memory = config.Property<bool>("LockMemory", false);
+  return low_latency;
+}
+
+bool ApplyLowLatency(const LowLatencyConfig& config) {
+  if (!config.enabled) {
+    return true;
+  }
+  bool applied = true;
+  if (config.cpu_core >= 0) {
+    if (const bool pinned = PinToCore(config.cpu_core); !pinned) {
+      LOG_ERROR() << "Failed to pin the thread. CPU Core: "
+        << config.cpu_core;
+      applied = false;
+    }
+  }
+
+  if (config.realtime_priority > 0) {
+    if (const bool priority = SetRealTimePriority(config.realtime_priority);
+        !priority) {
+      LOG_ERROR() << "Failed to set real-time priority. Priority: "
+        << config.realtime_priority;
+      applied = false;
+    }
+  }
+
+  if (config.lock_memory) {
+    if (const bool locked = LockMemory(); !locked) {
+      LOG_ERROR() << "Failed to lock the memory.";
+      applied = false;
+    }
+    PreFaultStack();
+  }
+  LOG_TRACE() << "Low-latency mode. CPU Core: " << config.cpu_core
+    << ", Busy Poll: " << (config.busy_poll ? "Yes" : "No")
+    << ", Priority: " << config.realtime_priority
+    << ", Lock Memory: " << (config.lock_memory ? "Yes" : "No");
+  return applied;
+}
+
+void BusyPollBackoff(uint32_t nof_empty_polls) {
+  if (nof_empty_polls < kSpinPolls) {
+    const uint32_t nof_pauses = std::min(nof_empty_polls + 1, kMaxPauses);
+    for (uint32_t pause = 0; pause < nof_pauses; ++pause) {
+      CpuPause();
+    }
+    return;
+  }
+  if (const auto sleep_time = BusyPollSleepTime(nof_empty_polls);
+      sleep_time > 0us) {
+    std::this_thread::sleep_for(sleep_time);
+    return;
+  }
+  std::this_thread::yield();
+}
+
+std::chrono::microseconds BusyPollSleepTime(uint32_t nof_empty_polls) {
+  if (nof_empty_polls < kSpinPolls + kYieldPolls) {
+    return 0us;
+  }
+  const uint32_t step = std::min<uint32_t>(
+    (nof_empty_polls - kSpinPolls - kYieldPolls) / kYieldPolls, 16);
+  return std::min<std::chrono::microseconds>(kMinSleep * (1U << step),
+                                             kMaxSleep);
+}
+
+}  // namespace bus
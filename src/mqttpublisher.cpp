@@ -0,0 +1,369 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/mqttpublisher.h"
+
+#include <util/logstream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <variant>
+
+#include <boost/asio/detached.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/mqtt5/mqtt_client.hpp>
+#include <boost/mqtt5/types.hpp>
+
+using namespace util::log;
+using namespace std::chrono_literals;
+
+namespace asio = boost::asio;
+namespace mqtt5 = boost::mqtt5;
+
+namespace {
+
+// Max time the Stop() function waits for queued and in-flight messages.
+constexpr auto kDrainTimeout = 5s;
+// Max time the Stop() function waits for the DISCONNECT sequence.
+constexpr auto kDisconnectTimeout = 3s;
+
+/** \brief Client logger that tracks the network connection.
+ *
+ * The client reconnects silently. The publisher needs to know about a new
+ * connection as the broker has forgotten the topic aliases.
+ */
+struct ConnectLogger {
+  std::atomic<uint64_t>* nof_connects = nullptr;
+  std::atomic<bool>* connected = nullptr;
+
+  void at_tcp_connect(mqtt5::error_code /* error */,
+                      asio::ip::tcp::endpoint /* endpoint */) {
+    // A new TCP connection means that the previous connection is lost.
+    *connected = false;
+  }
+
+  void at_connack(mqtt5::reason_code reason_code, bool /* session */,
+                  const mqtt5::connack_props& /* props */) {
+    if (!reason_code.is_error()) {
+      ++(*nof_connects);
+      *connected = true;
+    }
+  }
+
+  void at_disconnect(mqtt5::reason_code /* reason_code */,
+                     const mqtt5::disconnect_props& /* props */) {
+    *connected = false;
+  }
+
+  void at_transport_error(mqtt5::error_code /* error */) {
+    *connected = false;
+  }
+};
+
+}  // namespace
+
+namespace bus {
+
+struct MqttPublisher::Context {
+  using Client = mqtt5::mqtt_client<asio::ip::tcp::socket, std::monostate,
+                                    ConnectLogger>;
+
+  asio::io_context ioc;
+  asio::executor_work_guard<asio::io_context::executor_type> work_guard;
+  Client client;
+  asio::steady_timer stop_timer;
+
+  Context(std::atomic<uint64_t>& nof_connects, std::atomic<bool>& connected)
+  : work_guard(asio::make_work_guard(ioc)),
+    client(ioc, {}, ConnectLogger{&nof_connects, &connected}),
+    stop_timer(ioc) {}
+};
+
+uint16_t TopicAliasTable::Assign(const std::string& topic,
+                                 size_t max_aliases, bool& send_topic) {
+  send_topic = true;
+  if (topic.empty()) {
+    return 0;
+  }
+  if (const auto itr = alias_list_.find(topic);
+      itr != alias_list_.cend()) {
+    // The topic name is sent again until the broker has acknowledged it.
+    send_topic = confirmed_list_[itr->second - 1] == 0;
+    return itr->second;
+  }
+  if (alias_list_.size() >= max_aliases
+      || alias_list_.size() >= UINT16_MAX) {
+    return 0;
+  }
+  const auto alias = static_cast<uint16_t>(alias_list_.size() + 1);
+  alias_list_.emplace(topic, alias);
+  confirmed_list_.push_back(0);
+  return alias;
+}
+
+void TopicAliasTable::Confirm(uint16_t alias) {
+  if (alias > 0 && alias <= confirmed_list_.size()) {
+    confirmed_list_[alias - 1] = 1;
+  }
+}
+
+MqttPublisher::MqttPublisher() = default;
+
+MqttPublisher::~MqttPublisher() {
+  MqttPublisher::Stop();
+}
+
+void MqttPublisher::InFlightWindow(size_t window) {
+  if (window == 0) {
+    // No message would ever be sent.
+    LOG_WARNING() << "The in-flight window must be at least 1. Using 1.";
+    window = 1;
+  }
+  in_flight_window_ = window;
+}
+
+bool MqttPublisher::Start() {
+  Stop();
+  try {
+    if (host_.empty()) {
+      throw std::runtime_error("No broker host has been set.");
+    }
+    // The client is a plain TCP client. Refuse rather than silently
+    // sending the data unencrypted.
+    if (transport_ != metric::TransportLayer::MqttTcp) {
+      throw std::runtime_error(
+        "Only the TCP transport layer is supported. TLS and WebSocket are "
+        "not supported.");
+    }
+    nof_connects_ = 0;
+    connected_ = false;
+    alias_connect_ = 0;
+    context_ = std::make_unique<Context>(nof_connects_, connected_);
+    context_->client.brokers(host_, port_)
+      .credentials(client_id_, user_, password_)
+      .async_run(asio::detached);
+
+    in_flight_ = 0;
+    topic_aliases_.Reset();
+    started_ = true;
+    io_thread_ = std::thread(&MqttPublisher::IoThread, this);
+  } catch (const std::exception& err) {
+    LOG_ERROR() << "Failed to start the MQTT publisher. Broker: "
+      << host_ << ":" << port_ << ", Error: " << err.what();
+    started_ = false;
+    context_.reset();
+    return false;
+  }
+  return true;
+}
+
+void MqttPublisher::Stop() {
+  if (!context_) {
+    return;
+  }
+  started_ = false;
+
+  // Give the queued and in-flight messages a chance to be delivered.
+  const auto drain_stop = std::chrono::steady_clock::now() + kDrainTimeout;
+  while ((QueueSize() > 0 || in_flight_ > 0)
+         && std::chrono::steady_clock::now() < drain_stop) {
+    std::this_thread::sleep_for(10ms);
+  }
+
+  asio::post(context_->ioc, [this] {
+    auto& context = *context_;
+    context.stop_timer.expires_after(kDisconnectTimeout);
+    context.stop_timer.async_wait([this] (const mqtt5::error_code& error) {
+      if (!error) {
+        LOG_TRACE() << "MQTT disconnect timeout. Stopping the io context.";
+        context_->ioc.stop();
+      }
+    });
+    context.client.async_disconnect([this] (mqtt5::error_code) {
+      context_->client.cancel();
+      context_->stop_timer.cancel();
+      context_->work_guard.reset();
+    });
+  });
+
+  if (io_thread_.joinable()) {
+    io_thread_.join();
+  }
+  context_.reset();
+
+  std::scoped_lock lock(queue_locker_);
+  nof_dropped_ += queue_.size();
+  queue_.clear();
+  drain_posted_ = false;
+  in_flight_ = 0;
+}
+
+bool MqttPublisher::Publish(PublishMessage message) {
+  if (!started_) {
+    return false;
+  }
+  {
+    std::scoped_lock lock(queue_locker_);
+    if (queue_.size() >= max_queue_size_) {
+      ++nof_dropped_;
+      return false;
+    }
+    queue_.emplace_back(std::move(message));
+  }
+
+  // Only one drain request is posted for a burst of messages. This makes
+  // the io thread send the whole burst in one turn.
+  if (!drain_posted_.exchange(true)) {
+    asio::post(context_->ioc, [this] {
+      drain_posted_ = false;
+      Drain();
+    });
+  }
+  return true;
+}
+
+size_t MqttPublisher::QueueSize() const {
+  std::scoped_lock lock(queue_locker_);
+  return queue_.size();
+}
+
+void MqttPublisher::IoThread() {
+  try {
+    context_->ioc.run();
+  } catch (const std::exception& err) {
+    LOG_ERROR() << "MQTT publisher thread failed. Error: " << err.what();
+  }
+}
+
+void MqttPublisher::Drain() {
+  while (in_flight_ < in_flight_window_) {
+    PublishMessage message;
+    {
+      std::scoped_lock lock(queue_locker_);
+      if (queue_.empty()) {
+        break;
+      }
+      message = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    SendMessage(std::move(message));
+  }
+}
+
+void MqttPublisher::SendMessage(PublishMessage&& message) {
+  auto& client = context_->client;
+  const auto retain = message.retain ? mqtt5::retain_e::yes
+                                     : mqtt5::retain_e::no;
+  mqtt5::publish_props props;
+  uint16_t alias = 0;
+  if (topic_alias_maximum_ > 0) {
+    bool send_topic = true;
+    alias = AssignTopicAlias(message.topic, send_topic);
+    if (alias > 0) {
+      props[mqtt5::prop::topic_alias] = alias;
+      if (!send_topic) {
+        message.topic.clear();
+      }
+    }
+  }
+
+  if (std::string compressed;
+      compression_ && compressor_.Compress(message.payload, compressed)) {
+    message.payload = std::move(compressed);
+    props[mqtt5::prop::content_type] = std::string("application/zstd");
+    auto& user_properties = props[mqtt5::prop::user_property];
+    user_properties.emplace_back("zstd-dictionary",
+      std::to_string(compressor_.DictionaryId()));
+    if (!message.content_type.empty()) {
+      user_properties.emplace_back("content-type",
+        std::move(message.content_type));
+    }
+  } else if (!message.content_type.empty()) {
+    props[mqtt5::prop::content_type] = std::move(message.content_type);
+  }
+
+  // QoS 0 completes with (error), QoS 1 and QoS 2 completes with
+  // (error, reason code, properties).
+  auto handler = [this, alias, connect = alias_connect_]
+      (mqtt5::error_code error, auto&&... args) {
+    bool rejected = false;
+    if constexpr (sizeof...(args) > 0) {
+      rejected = std::get<0>(std::forward_as_tuple(args...)).is_error();
+    }
+    OnComplete(!error && !rejected, alias, connect);
+  };
+
+  ++in_flight_;
+  ++nof_published_;
+  switch (qos_) {
+    case PublishQos::AtMostOnce:
+      client.async_publish<mqtt5::qos_e::at_most_once>(
+        std::move(message.topic), std::move(message.payload), retain,
+        std::move(props), std::move(handler));
+      break;
+
+    case PublishQos::ExactlyOnce:
+      client.async_publish<mqtt5::qos_e::exactly_once>(
+        std::move(message.topic), std::move(message.payload), retain,
+        std::move(props), std::move(handler));
+      break;
+
+    case PublishQos::AtLeastOnce:
+    default:
+      client.async_publish<mqtt5::qos_e::at_least_once>(
+        std::move(message.topic), std::move(message.payload), retain,
+        std::move(props), std::move(handler));
+      break;
+  }
+}
+
+uint16_t MqttPublisher::AssignTopicAlias(const std::string& topic,
+                                         bool& send_topic) {
+  // The message may be sent on the next connection. Send the topic name.
+  send_topic = true;
+  if (!connected_) {
+    return 0;
+  }
+  // The aliases only live as long as the network connection. The client
+  // reconnects silently, so a new connection resets the aliases.
+  if (const uint64_t connect = nof_connects_; connect != alias_connect_) {
+    topic_aliases_.Reset();
+    alias_connect_ = connect;
+  }
+
+  // The broker defines how many aliases it accepts. No CONNACK property
+  // means that the broker doesn't accept any topic aliases.
+  const auto broker_max = context_->client.connack_property(
+    mqtt5::prop::topic_alias_maximum);
+  const size_t max_aliases = std::min<size_t>(topic_alias_maximum_,
+    broker_max.value_or(0));
+  return topic_aliases_.Assign(topic, max_aliases, send_topic);
+}
+
+void MqttPublisher::OnComplete(bool success, uint16_t alias,
+                               uint64_t connect) {
+  if (in_flight_ > 0) {
+    --in_flight_;
+  }
+  if (success) {
+    ++nof_completed_;
+    // Only an acknowledge on the connection that defined the alias proves
+    // that the broker knows the topic name.
+    if (alias > 0 && connect == alias_connect_ && connect == nof_connects_) {
+      topic_aliases_.Confirm(alias);
+    }
+  } else {
+    ++nof_failed_;
+  }
+  // A slot in the window is free. Send the next queued message.
+  Drain();
+}
+
+}  // namespace bus
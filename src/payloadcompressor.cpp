@@ -0,0 +1,130 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/payloadcompressor.h"
+
+#include <util/logstream.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <zstd.h>
+
+using namespace util::log;
+
+namespace bus {
+
+struct PayloadCompressor::Context {
+  ZSTD_CCtx* cctx = nullptr;
+  ZSTD_CDict* cdict = nullptr;
+  int cdict_level = 0; ///< Level used when the CDict was created.
+  std::string dictionary;
+
+  Context() : cctx(ZSTD_createCCtx()) {}
+  ~Context() {
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeCCtx(cctx);
+  }
+};
+
+PayloadCompressor::PayloadCompressor()
+: context_(std::make_unique<Context>()) {
+}
+
+PayloadCompressor::~PayloadCompressor() = default;
+
+bool PayloadCompressor::LoadDictionary(const std::string& filename) {
+  if (filename.empty()) {
+    return SetDictionary({});
+  }
+  try {
+    if (!std::filesystem::exists(filename)) {
+      throw std::runtime_error("The dictionary file doesn't exist.");
+    }
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open the dictionary file.");
+    }
+    const std::string dictionary((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+    if (const bool set = SetDictionary(dictionary); !set) {
+      throw std::runtime_error("Invalid dictionary.");
+    }
+  } catch (const std::exception& err) {
+    LOG_ERROR() << "Failed to load the compression dictionary. File: "
+      << filename << ", Error: " << err.what();
+    return false;
+  }
+  return true;
+}
+
+bool PayloadCompressor::SetDictionary(const std::string& dictionary) {
+  auto& context = *context_;
+  ZSTD_freeCDict(context.cdict);
+  context.cdict = nullptr;
+  context.dictionary.clear();
+  dictionary_id_ = 0;
+  if (dictionary.empty()) {
+    return true;
+  }
+  if (context.cctx == nullptr) {
+    return false;
+  }
+
+  // The consumers find the dictionary by its ID, so a raw content
+  // dictionary without a zstd dictionary header isn't accepted.
+  const auto dictionary_id = static_cast<uint32_t>(
+    ZSTD_getDictID_fromDict(dictionary.data(), dictionary.size()));
+  if (dictionary_id == 0) {
+    return false;
+  }
+  // The dictionary is digested now, so invalid entropy tables are
+  // detected. Compress() digests it again if the level is changed.
+  context.cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(),
+                                   level_);
+  if (context.cdict == nullptr) {
+    return false;
+  }
+  context.cdict_level = level_;
+  context.dictionary = dictionary;
+  dictionary_id_ = dictionary_id;
+  return true;
+}
+
+bool PayloadCompressor::Compress(const std::string& input,
+                                 std::string& output) {
+  auto& context = *context_;
+  if (context.cctx == nullptr || input.empty()) {
+    return false;
+  }
+  if (!context.dictionary.empty()
+      && (context.cdict == nullptr || context.cdict_level != level_)) {
+    ZSTD_freeCDict(context.cdict);
+    context.cdict = ZSTD_createCDict(context.dictionary.data(),
+      context.dictionary.size(), level_);
+    context.cdict_level = level_;
+    if (context.cdict == nullptr) {
+      return false;
+    }
+  }
+
+  output.resize(ZSTD_compressBound(input.size()));
+  const size_t size = context.cdict != nullptr
+    ? ZSTD_compress_usingCDict(context.cctx, output.data(), output.size(),
+                               input.data(), input.size(), context.cdict)
+    : ZSTD_compressCCtx(context.cctx, output.data(), output.size(),
+                        input.data(), input.size(), level_);
+  if (ZSTD_isError(size) || size >= input.size()) {
+    output.clear();
+    return false;
+  }
+  output.resize(size);
+  raw_bytes_ += input.size();
+  compressed_bytes_ += size;
+  return true;
+}
+
+}  // namespace bus
@@ -0,0 +1,190 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/selectionindex.h"
+
+#include <algorithm>
+
+namespace {
+
+bool SegmentMatch(std::string_view segment, std::string_view text) {
+  return std::ranges::equal(segment, text, [] (char pattern, char in_char) {
+    return pattern == '?' || pattern == in_char;
+  });
+}
+
+size_t SegmentFind(std::string_view segment, std::string_view text,
+                   size_t start) {
+  if (segment.size() > text.size()) {
+    return std::string_view::npos;
+  }
+  for (size_t pos = start; pos + segment.size() <= text.size(); ++pos) {
+    if (SegmentMatch(segment, text.substr(pos, segment.size()))) {
+      return pos;
+    }
+  }
+  return std::string_view::npos;
+}
+
+}  // namespace
+
+namespace bus {
+
+GlobPattern::GlobPattern(std::string_view pattern)
+: pattern_(pattern) {
+  match_all_ = pattern.empty()
+      || std::ranges::all_of(pattern, [] (char in_char) {
+        return in_char == '*';
+      });
+  if (match_all_) {
+    return;
+  }
+  exact_ = pattern.find_first_of("*?") == std::string_view::npos;
+  if (exact_) {
+    return;
+  }
+  anchor_front_ = pattern.front() != '*';
+  anchor_back_ = pattern.back() != '*';
+
+  size_t start = 0;
+  while (start <= pattern.size()) {
+    const size_t end = pattern.find('*', start);
+    const auto segment = pattern.substr(start,
+      end == std::string_view::npos ? std::string_view::npos : end - start);
+    if (!segment.empty()) {
+      segment_list_.emplace_back(segment);
+    }
+    if (end == std::string_view::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+}
+
+bool GlobPattern::Match(std::string_view text) const {
+  if (match_all_) {
+    return true;
+  }
+  if (exact_) {
+    return text == pattern_;
+  }
+
+  size_t pos = 0;
+  for (size_t index = 0; index < segment_list_.size(); ++index) {
+    const std::string_view segment = segment_list_[index];
+    const bool first = index == 0;
+    const bool last = index + 1 == segment_list_.size();
+
+    if (first && anchor_front_) {
+      if (!SegmentMatch(segment, text.substr(0, segment.size()))) {
+        return false;
+      }
+      pos = segment.size();
+      if (last && anchor_back_) {
+        return pos == text.size();
+      }
+      continue;
+    }
+    if (last && anchor_back_) {
+      if (segment.size() > text.size() - pos) {
+        return false;
+      }
+      const size_t tail = text.size() - segment.size();
+      return SegmentMatch(segment, text.substr(tail));
+    }
+    const size_t found = SegmentFind(segment, text, pos);
+    if (found == std::string_view::npos) {
+      return false;
+    }
+    pos = found + segment.size();
+  }
+  return !anchor_back_ || pos == text.size();
+}
+
+void SelectionIndex::AddSignal(uint64_t ident, std::string_view message_name,
+                               std::string_view signal_name) {
+  auto& message = message_list_[ident];
+  if (message.name.empty()) {
+    message.name = message_name;
+  }
+  if (const auto [itr, inserted] =
+        message.signal_list.emplace(signal_name);
+      inserted) {
+    ++nof_signals_;
+  }
+}
+
+void SelectionIndex::AddRule(SelectionRule rule) {
+  if (rule.min_ident > rule.max_ident) {
+    std::swap(rule.min_ident, rule.max_ident);
+  }
+  rule_list_.emplace_back(std::move(rule));
+}
+
+bool SelectionIndex::IsMessageSelected(uint64_t ident,
+                                       std::string_view message_name,
+                                       std::string_view node_name) const {
+  if (message_list_.contains(ident)) {
+    return true;
+  }
+  return std::ranges::any_of(rule_list_, [&] (const SelectionRule& rule) {
+    return ident >= rule.min_ident && ident <= rule.max_ident
+      && rule.node.Match(node_name) && rule.message.Match(message_name);
+  });
+}
+
+bool SelectionIndex::IsSignalSelected(uint64_t ident,
+                                      std::string_view message_name,
+                                      std::string_view node_name,
+                                      std::string_view signal_name) const {
+  if (const auto itr = message_list_.find(ident);
+      itr != message_list_.cend()
+      && itr->second.signal_list.contains(signal_name)) {
+    return true;
+  }
+  return IsRuleSelected(ident, message_name, node_name, signal_name);
+}
+
+bool SelectionIndex::IsRuleSelected(uint64_t ident,
+                                    std::string_view message_name,
+                                    std::string_view node_name,
+                                    std::string_view signal_name) const {
+  return std::ranges::any_of(rule_list_, [&] (const SelectionRule& rule) {
+    return ident >= rule.min_ident && ident <= rule.max_ident
+      && rule.node.Match(node_name) && rule.message.Match(message_name)
+      && rule.signal.Match(signal_name);
+  });
+}
+
+std::string_view SelectionIndex::MessageName(uint64_t ident) const {
+  const auto itr = message_list_.find(ident);
+  return itr != message_list_.cend() ? std::string_view(itr->second.name)
+                                     : std::string_view();
+}
+
+std::vector<SelectedSignal> SelectionIndex::Signals() const {
+  std::vector<SelectedSignal> signal_list;
+  signal_list.reserve(nof_signals_);
+  for (const auto& [ident, message] : message_list_) {
+    for (const auto& signal_name : message.signal_list) {
+      signal_list.push_back({ident, message.name, signal_name});
+    }
+  }
+  std::ranges::sort(signal_list, [] (const SelectedSignal& signal1,
+                                     const SelectedSignal& signal2) {
+    return signal1.ident != signal2.ident ? signal1.ident < signal2.ident
+                                          : signal1.signal_name
+                                            < signal2.signal_name;
+  });
+  return signal_list;
+}
+
+void SelectionIndex::Clear() {
+  message_list_.clear();
+  rule_list_.clear();
+  nof_signals_ = 0;
+}
+
+}  // namespace bus
@@ -0,0 +1,49 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/signalringbuffer.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace bus {
+
+SignalRingBuffer::SignalRingBuffer(size_t capacity)
+: mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1) {
+  slot_list_ = std::make_unique<Slot[]>(mask_ + 1);
+}
+
+size_t SignalRingBuffer::Snapshot(uint64_t from_time, uint64_t to_time,
+                                  std::vector<SignalSample>& sample_list)
+    const {
+  const size_t capacity = Capacity();
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  const uint64_t first = head > capacity ? head - capacity : 0;
+
+  const size_t start = sample_list.size();
+  std::vector<uint64_t> index_list;
+  for (uint64_t index = first; index < head; ++index) {
+    const auto& slot = slot_list_[index & mask_];
+    SignalSample sample;
+    sample.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+    sample.value = slot.value.load(std::memory_order_relaxed);
+    if (sample.timestamp >= from_time && sample.timestamp <= to_time) {
+      sample_list.push_back(sample);
+      index_list.push_back(index);
+    }
+  }
+
+  // Drop the samples that the writer may have overwritten during the copy.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t new_head = head_.load(std::memory_order_relaxed);
+  const uint64_t valid = new_head >= capacity ? new_head - capacity + 1 : 0;
+  const auto overwritten = static_cast<size_t>(
+    std::ranges::lower_bound(index_list, valid) - index_list.cbegin());
+  sample_list.erase(sample_list.begin() + static_cast<std::ptrdiff_t>(start),
+    sample_list.begin() + static_cast<std::ptrdiff_t>(start + overwritten));
+  return sample_list.size() - start;
+}
+
+}  // namespace bus
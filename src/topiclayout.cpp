@@ -0,0 +1,134 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/topiclayout.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <string>
+
+namespace {
+
+constexpr std::array<std::string_view, 4> kLayoutNames = {
+  "Message", "Signal", "Node", "Custom"
+};
+
+bool IEquals(std::string_view text1, std::string_view text2) {
+  return std::ranges::equal(text1, text2, [] (char char1, char char2) {
+    return std::tolower(static_cast<unsigned char>(char1))
+        == std::tolower(static_cast<unsigned char>(char2));
+  });
+}
+
+void AddTopicLevel(std::string& topic, std::string_view name) {
+  for (const char in_char : name) {
+    switch (in_char) {
+      case '/':
+      case '+':
+      case '#':
+        topic.push_back('_');
+        break;
+
+      default:
+        topic.push_back(in_char);
+        break;
+    }
+  }
+}
+
+}  // namespace
+
+namespace bus {
+
+std::string_view TopicLayoutToString(TopicLayout layout) {
+  const auto index = static_cast<size_t>(layout);
+  return index < kLayoutNames.size() ? kLayoutNames[index] : kLayoutNames[0];
+}
+
+TopicLayout StringToTopicLayout(std::string_view text) {
+  for (size_t index = 0; index < kLayoutNames.size(); ++index) {
+    if (IEquals(text, kLayoutNames[index])) {
+      return static_cast<TopicLayout>(index);
+    }
+  }
+  return TopicLayout::PerMessage;
+}
+
+std::string TopicTemplate(TopicLayout layout,
+                          const std::string& custom_template) {
+  switch (layout) {
+    case TopicLayout::PerSignal:
+      return "{prefix}/{message}/{signal}";
+
+    case TopicLayout::PerNode:
+      return "{prefix}/{node}/{message}";
+
+    case TopicLayout::Custom:
+      if (!custom_template.empty()) {
+        return custom_template;
+      }
+      break;
+
+    default:
+      break;
+  }
+  return "{prefix}/{message}";
+}
+
+std::string TopicLevel(std::string_view name) {
+  std::string level;
+  level.reserve(name.size());
+  AddTopicLevel(level, name);
+  return level;
+}
+
+bool IsSignalTopicTemplate(std::string_view topic_template) {
+  return topic_template.find("{signal}") != std::string_view::npos;
+}
+
+std::string ExpandTopicTemplate(std::string_view topic_template,
+                                std::string_view prefix,
+                                std::string_view node,
+                                std::string_view message,
+                                int64_t message_id,
+                                std::string_view signal) {
+  const std::string id = std::to_string(message_id);
+  std::string topic;
+  topic.reserve(topic_template.size() + message.size() + signal.size());
+
+  size_t pos = 0;
+  while (pos < topic_template.size()) {
+    if (topic_template[pos] != '{') {
+      topic.push_back(topic_template[pos++]);
+      continue;
+    }
+    const size_t end = topic_template.find('}', pos);
+    if (end == std::string_view::npos) {
+      topic.append(topic_template.substr(pos));
+      break;
+    }
+    const auto key = topic_template.substr(pos + 1, end - pos - 1);
+    if (key == "prefix") {
+      // The prefix may define more than one level.
+      topic.append(prefix);
+    } else if (key == "node") {
+      AddTopicLevel(topic, node.empty() ? std::string_view("NoNode") : node);
+    } else if (key == "message") {
+      AddTopicLevel(topic, message.empty() ? std::string_view(id) : message);
+    } else if (key == "id") {
+      topic.append(id);
+    } else if (key == "signal") {
+      AddTopicLevel(topic, signal);
+    } else {
+      // Unknown place holder. Keep it as is.
+      topic.append(topic_template.substr(pos, end - pos + 1));
+    }
+    pos = end + 1;
+  }
+  return topic;
+}
+
+}  // namespace bus
@@ -0,0 +1,412 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include "bus/triggerexpression.h"
+
+#include <util/logstream.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+using namespace util::log;
+
+namespace {
+
+enum class TokenType {
+  End,
+  Number,
+  Name,
+  Operator,
+  LeftParenthesis,
+  RightParenthesis
+};
+
+struct Token {
+  TokenType type = TokenType::End;
+  std::string_view text;
+  double value = 0.0;
+};
+
+bool IsNameChar(char in_char) {
+  return std::isalnum(static_cast<unsigned char>(in_char)) != 0
+    || in_char == '_' || in_char == '.';
+}
+
+bool EqualNoCase(std::string_view text1, std::string_view text2) {
+  return std::ranges::equal(text1, text2, [] (char char1, char char2) {
+    return std::tolower(static_cast<unsigned char>(char1))
+      == std::tolower(static_cast<unsigned char>(char2));
+  });
+}
+
+/** \brief Recursive descent parser that emits the byte code. */
+class Parser {
+ public:
+  Parser(std::string_view expression,
+         const bus::TriggerExpression::SignalResolver& resolver,
+         std::vector<bus::TriggerInstruction>& instruction_list,
+         std::vector<int32_t>& signal_list)
+  : expression_(expression),
+    resolver_(resolver),
+    instruction_list_(instruction_list),
+    signal_list_(signal_list) {
+    Next();
+  }
+
+  void Parse() {
+    ParseOr();
+    if (token_.type != TokenType::End) {
+      Error("Unexpected token");
+    }
+  }
+
+  [[nodiscard]] size_t MaxDepth() const { return max_depth_; }
+
+ private:
+  std::string_view expression_;
+  const bus::TriggerExpression::SignalResolver& resolver_;
+  std::vector<bus::TriggerInstruction>& instruction_list_;
+  std::vector<int32_t>& signal_list_;
+  size_t pos_ = 0;
+  Token token_;
+  size_t depth_ = 0;
+  size_t max_depth_ = 0;
+
+  [[noreturn]] void Error(std::string_view message) const {
+    std::string error(message);
+    error += ". Position: ";
+    error += std::to_string(pos_ - token_.text.size());
+    if (!token_.text.empty()) {
+      error += ", Token: ";
+      error += token_.text;
+    }
+    throw std::runtime_error(error);
+  }
+
+  void Next() {
+    while (pos_ < expression_.size()
+           && std::isspace(static_cast<unsigned char>(expression_[pos_]))) {
+      ++pos_;
+    }
+    token_ = {};
+    if (pos_ >= expression_.size()) {
+      return;
+    }
+    const size_t start = pos_;
+    const char in_char = expression_[pos_];
+    if (std::isdigit(static_cast<unsigned char>(in_char)) || in_char == '.') {
+      const auto [ptr, error] = std::from_chars(expression_.data() + pos_,
+        expression_.data() + expression_.size(), token_.value);
+      if (error != std::errc()) {
+        Error("Invalid number");
+      }
+      pos_ = static_cast<size_t>(ptr - expression_.data());
+      token_.type = TokenType::Number;
+    } else if (IsNameChar(in_char)) {
+      while (pos_ < expression_.size() && IsNameChar(expression_[pos_])) {
+        ++pos_;
+      }
+      token_.type = TokenType::Name;
+    } else if (in_char == '(') {
+      ++pos_;
+      token_.type = TokenType::LeftParenthesis;
+    } else if (in_char == ')') {
+      ++pos_;
+      token_.type = TokenType::RightParenthesis;
+    } else {
+      constexpr std::array<std::string_view, 15> kOperators = {
+        "&&", "||", "<=", ">=", "==", "!=", "<", ">", "=", "!",
+        "+", "-", "*", "/", "&"};
+      const auto rest = expression_.substr(pos_);
+      const auto itr = std::ranges::find_if(kOperators,
+        [&] (std::string_view op) { return rest.starts_with(op); });
+      if (itr == kOperators.cend()) {
+        pos_ = start + 1;
+        token_.text = expression_.substr(start, 1);
+        Error("Invalid character");
+      }
+      pos_ += itr->size();
+      token_.type = TokenType::Operator;
+    }
+    token_.text = expression_.substr(start, pos_ - start);
+
+    // Keywords are easier to write in XML files.
+    if (token_.type == TokenType::Name) {
+      if (EqualNoCase(token_.text, "and")) {
+        token_.type = TokenType::Operator;
+        token_.text = "&&";
+      } else if (EqualNoCase(token_.text, "or")) {
+        token_.type = TokenType::Operator;
+        token_.text = "||";
+      } else if (EqualNoCase(token_.text, "not")) {
+        token_.type = TokenType::Operator;
+        token_.text = "!";
+      }
+    }
+  }
+
+  [[nodiscard]] bool IsOperator(std::string_view op) const {
+    return token_.type == TokenType::Operator && token_.text == op;
+  }
+
+  void Emit(bus::TriggerOp op, int32_t index = 0, double value = 0.0) {
+    instruction_list_.push_back({op, index, value});
+    switch (op) {
+      case bus::TriggerOp::Constant:
+      case bus::TriggerOp::Signal:
+        max_depth_ = std::max(max_depth_, ++depth_);
+        break;
+
+      case bus::TriggerOp::Negate:
+      case bus::TriggerOp::Not:
+        break;
+
+      default:
+        --depth_; // Binary operation
+        break;
+    }
+  }
+
+  void ParseOr() {
+    ParseAnd();
+    while (IsOperator("||")) {
+      Next();
+      ParseAnd();
+      Emit(bus::TriggerOp::Or);
+    }
+  }
+
+  void ParseAnd() {
+    ParseCompare();
+    while (IsOperator("&&") || IsOperator("&")) {
+      Next();
+      ParseCompare();
+      Emit(bus::TriggerOp::And);
+    }
+  }
+
+  void ParseCompare() {
+    ParseSum();
+    struct Compare {
+      std::string_view text;
+      bus::TriggerOp op;
+    };
+    constexpr std::array<Compare, 7> kCompareList = {{
+      {"<", bus::TriggerOp::Less},
+      {"<=", bus::TriggerOp::LessEqual},
+      {">", bus::TriggerOp::Greater},
+      {">=", bus::TriggerOp::GreaterEqual},
+      {"==", bus::TriggerOp::Equal},
+      {"=", bus::TriggerOp::Equal},
+      {"!=", bus::TriggerOp::NotEqual}
+    }};
+    const auto itr = std::ranges::find_if(kCompareList,
+      [&] (const Compare& compare) { return IsOperator(compare.text); });
+    if (itr == kCompareList.cend()) {
+      return;
+    }
+    Next();
+    ParseSum();
+    Emit(itr->op);
+  }
+
+  void ParseSum() {
+    ParseProduct();
+    while (IsOperator("+") || IsOperator("-")) {
+      const bool add = IsOperator("+");
+      Next();
+      ParseProduct();
+      Emit(add ? bus::TriggerOp::Add : bus::TriggerOp::Subtract);
+    }
+  }
+
+  void ParseProduct() {
+    ParseUnary();
+    while (IsOperator("*") || IsOperator("/")) {
+      const bool multiply = IsOperator("*");
+      Next();
+      ParseUnary();
+      Emit(multiply ? bus::TriggerOp::Multiply : bus::TriggerOp::Divide);
+    }
+  }
+
+  void ParseUnary() {
+    if (IsOperator("-")) {
+      Next();
+      ParseUnary();
+      Emit(bus::TriggerOp::Negate);
+    } else if (IsOperator("!")) {
+      Next();
+      ParseUnary();
+      Emit(bus::TriggerOp::Not);
+    } else if (IsOperator("+")) {
+      Next();
+      ParseUnary();
+    } else {
+      ParsePrimary();
+    }
+  }
+
+  void ParsePrimary() {
+    switch (token_.type) {
+      case TokenType::Number:
+        Emit(bus::TriggerOp::Constant, 0, token_.value);
+        Next();
+        break;
+
+      case TokenType::Name: {
+        if (EqualNoCase(token_.text, "true")
+            || EqualNoCase(token_.text, "false")) {
+          Emit(bus::TriggerOp::Constant, 0,
+               EqualNoCase(token_.text, "true") ? 1.0 : 0.0);
+          Next();
+          break;
+        }
+        const int32_t index = resolver_ ? resolver_(token_.text) : -1;
+        if (index < 0) {
+          Error("Unknown signal");
+        }
+        Emit(bus::TriggerOp::Signal, index);
+        if (std::ranges::find(signal_list_, index) == signal_list_.cend()) {
+          signal_list_.push_back(index);
+        }
+        Next();
+        break;
+      }
+
+      case TokenType::LeftParenthesis:
+        Next();
+        ParseOr();
+        if (token_.type != TokenType::RightParenthesis) {
+          Error("Missing ')'");
+        }
+        Next();
+        break;
+
+      case TokenType::End:
+        Error("Unexpected end of expression");
+
+      default:
+        Error("Unexpected token");
+    }
+  }
+};
+
+}  // namespace
+
+namespace bus {
+
+bool TriggerExpression::Compile(std::string_view expression,
+                                const SignalResolver& resolver) {
+  expression_ = expression;
+  instruction_list_.clear();
+  signal_list_.clear();
+  last_error_.clear();
+  try {
+    Parser parser(expression, resolver, instruction_list_, signal_list_);
+    parser.Parse();
+    if (parser.MaxDepth() > kMaxStack) {
+      throw std::runtime_error("The expression is too complex.");
+    }
+    instruction_list_.shrink_to_fit();
+  } catch (const std::exception& err) {
+    last_error_ = err.what();
+    LOG_ERROR() << "Failed to compile the trigger expression. Expression: "
+      << expression << ", Error: " << err.what();
+    instruction_list_.clear();
+    signal_list_.clear();
+    return false;
+  }
+  return true;
+}
+
+double TriggerExpression::Evaluate(std::span<const double> value_list) const {
+  std::array<double, kMaxStack> stack; // NOLINT
+  size_t top = 0;
+  for (const auto& instruction : instruction_list_) {
+    switch (instruction.op) {
+      case TriggerOp::Constant:
+        stack[top++] = instruction.value;
+        continue;
+
+      case TriggerOp::Signal:
+        stack[top++] = static_cast<size_t>(instruction.index)
+          < value_list.size() ? value_list[instruction.index] : 0.0;
+        continue;
+
+      case TriggerOp::Negate:
+        stack[top - 1] = -stack[top - 1];
+        continue;
+
+      case TriggerOp::Not:
+        stack[top - 1] = stack[top - 1] == 0.0 ? 1.0 : 0.0;
+        continue;
+
+      default:
+        break;
+    }
+
+    const double right = stack[--top];
+    double& left = stack[top - 1];
+    switch (instruction.op) {
+      case TriggerOp::Add:
+        left += right;
+        break;
+
+      case TriggerOp::Subtract:
+        left -= right;
+        break;
+
+      case TriggerOp::Multiply:
+        left *= right;
+        break;
+
+      case TriggerOp::Divide:
+        left = right != 0.0 ? left / right : 0.0;
+        break;
+
+      case TriggerOp::Less:
+        left = left < right ? 1.0 : 0.0;
+        break;
+
+      case TriggerOp::LessEqual:
+        left = left <= right ? 1.0 : 0.0;
+        break;
+
+      case TriggerOp::Greater:
+        left = left > right ? 1.0 : 0.0;
+        break;
+
+      case TriggerOp::GreaterEqual:
+        left = left >= right ? 1.0 : 0.0;
+        break;
+
+      case TriggerOp::Equal:
+        left = left == right ? 1.0 : 0.0;
+        break;
+
+      case TriggerOp::NotEqual:
+        left = left != right ? 1.0 : 0.0;
+        break;
+
+      case TriggerOp::And:
+        left = left != 0.0 && right != 0.0 ? 1.0 : 0.0;
+        break;
+
+      case TriggerOp::Or:
+        left = left != 0.0 || right != 0.0 ? 1.0 : 0.0;
+        break;
+
+      default:
+        break;
+    }
+  }
+  return top > 0 ? stack[0] : 0.0;
+}
+
+}  // namespace bus
@@ -0,0 +1,190 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <bus/candataframe.h>
+#include <bus/ibusmessagequeue.h>
+
+#include "cangenerator.h"
+
+using namespace std::chrono_literals;
+using namespace std::filesystem;
+
+namespace {
+
+// A classic CAN message each 10 ms and a CAN FD message each 100 ms.
+constexpr std::string_view kGeneratorDbc = R"(VERSION ""
+
+NS_ :
+
+BS_:
+
+BU_: ECU
+
+BO_ 256 Classic: 2 ECU
+ SG_ Speed : 0|16@1+ (0.1,0) [0|250] "km/h" Vector__XXX
+
+BO_ 512 Fd: 13 ECU
+ SG_ Temp : 0|8@1+ (1,-40) [-40|200] "degC" Vector__XXX
+
+BA_DEF_ BO_  "GenMsgCycleTime" INT 0 10000;
+BA_DEF_DEF_  "GenMsgCycleTime" 0;
+BA_ "GenMsgCycleTime" BO_ 256 10;
+BA_ "GenMsgCycleTime" BO_ 512 100;
+)";
+
+/** \brief Writes the test DBC file and returns its path. */
+path MakeDbcFile() {
+  const path dbc_path = temp_directory_path() / "test_cangenerator.dbc";
+  std::ofstream file(dbc_path);
+  file << kGeneratorDbc;
+  return dbc_path;
+}
+
+/** \brief Number of frames of each message ident. */
+std::map<uint64_t, size_t> CountFrames(
+    const std::vector<bus::CanGenerator::SentFrame>& frame_list) {
+  std::map<uint64_t, size_t> count_list;
+  for (const auto& frame : frame_list) {
+    ++count_list[frame.key >> 32];
+  }
+  return count_list;
+}
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestCanGenerator, TestFrameBits) {
+  // Worst case classic CAN frames with 8 data bytes.
+  EXPECT_EQ(CanGenerator::FrameBits(8, false, false), 135);
+  EXPECT_EQ(CanGenerator::FrameBits(8, true, false), 160);
+  EXPECT_LT(CanGenerator::FrameBits(0, false, false),
+            CanGenerator::FrameBits(8, false, false));
+
+  // CAN FD frames have a longer control field and CRC.
+  EXPECT_GT(CanGenerator::FrameBits(8, false, true),
+            CanGenerator::FrameBits(8, false, false));
+  EXPECT_GT(CanGenerator::FrameBits(8, true, true),
+            CanGenerator::FrameBits(8, false, true));
+  EXPECT_GT(CanGenerator::FrameBits(20, false, true),
+            CanGenerator::FrameBits(16, false, true) + 32);
+  EXPECT_EQ(CanGenerator::FrameBits(64, false, true), 712);
+}
+
+TEST(TestCanGenerator, TestDataLength) {
+  EXPECT_EQ(CanGenerator::DataLength(2, 1), 2);
+  EXPECT_EQ(CanGenerator::DataLength(0, 3), 3);
+  EXPECT_EQ(CanGenerator::DataLength(8, 8), 8);
+  EXPECT_EQ(CanGenerator::DataLength(8, 10), 12);
+  EXPECT_EQ(CanGenerator::DataLength(13, 2), 16);
+  EXPECT_EQ(CanGenerator::DataLength(64, 0), 64);
+  EXPECT_EQ(CanGenerator::DataLength(80, 0), 64);
+}
+
+TEST(TestCanGenerator, TestBurstPeriod) {
+  CanGenerator generator;
+  EXPECT_TRUE(generator.Burst(10, 100ms));
+  EXPECT_EQ(generator.BurstFrames(), 10);
+
+  EXPECT_FALSE(generator.Burst(10, 0ms));
+  EXPECT_EQ(generator.BurstFrames(), 0);
+
+  EXPECT_TRUE(generator.Burst(0, 0ms));
+  EXPECT_EQ(generator.BurstFrames(), 0);
+}
+
+TEST(TestCanGenerator, TestDlc) {
+  const path dbc_path = MakeDbcFile();
+  CanGenerator generator;
+  ASSERT_TRUE(generator.ReadDbcFile(dbc_path.string()));
+  EXPECT_EQ(generator.NofMessages(), 2);
+
+  auto queue = std::make_shared<IBusMessageQueue>();
+  queue->Start();
+  ASSERT_TRUE(generator.Start(queue));
+  std::this_thread::sleep_for(300ms);
+
+  std::map<uint32_t, size_t> length_list;
+  for (auto msg = queue->Pop(); msg; msg = queue->Pop()) {
+    const CanDataFrame frame(msg);
+    length_list[frame.MessageId()] = frame.DataBytes().size();
+  }
+  generator.Stop();
+
+  // The DBC length is used. Above 8 bytes it is a CAN FD length.
+  ASSERT_EQ(length_list.size(), 2);
+  EXPECT_EQ(length_list[256], 2);
+  EXPECT_EQ(length_list[512], 16);
+
+  const double bits = 100.0 * CanGenerator::FrameBits(2, false, false)
+                    + 10.0 * CanGenerator::FrameBits(16, false, true);
+  EXPECT_NEAR(generator.EstimatedBusLoad(), 100.0 * bits / 500'000, 0.01);
+  remove(dbc_path);
+}
+
+TEST(TestCanGenerator, TestRate) {
+  const path dbc_path = MakeDbcFile();
+  CanGenerator generator;
+  ASSERT_TRUE(generator.ReadDbcFile(dbc_path.string()));
+  generator.TrackFrames(true);
+
+  auto queue = std::make_shared<IBusMessageQueue>();
+  queue->Start();
+  ASSERT_TRUE(generator.Start(queue));
+  std::this_thread::sleep_for(1s);
+  generator.Stop();
+
+  std::vector<CanGenerator::SentFrame> frame_list;
+  generator.TakeFrames(frame_list);
+  EXPECT_EQ(frame_list.size(), generator.NofFrames());
+
+  auto count_list = CountFrames(frame_list);
+  EXPECT_NEAR(static_cast<double>(count_list[256]), 100.0, 20.0);
+  EXPECT_NEAR(static_cast<double>(count_list[512]), 10.0, 3.0);
+
+  // The timestamps are unique and identify the frames.
+  for (size_t index = 1; index < frame_list.size(); ++index) {
+    EXPECT_GT(frame_list[index].timestamp, frame_list[index - 1].timestamp);
+  }
+  remove(dbc_path);
+}
+
+TEST(TestCanGenerator, TestBurst) {
+  const path dbc_path = MakeDbcFile();
+  CanGenerator generator;
+  ASSERT_TRUE(generator.ReadDbcFile(dbc_path.string()));
+  ASSERT_TRUE(generator.Burst(50, 100ms));
+  generator.TrackFrames(true);
+
+  auto queue = std::make_shared<IBusMessageQueue>();
+  queue->Start();
+  ASSERT_TRUE(generator.Start(queue));
+  std::this_thread::sleep_for(1050ms);
+  generator.Stop();
+
+  std::vector<CanGenerator::SentFrame> frame_list;
+  generator.TakeFrames(frame_list);
+  // About 110 cyclic frames and 10 bursts of 50 frames.
+  EXPECT_GE(frame_list.size(), 90 + 8 * 50);
+  EXPECT_LE(frame_list.size(), 130 + 11 * 50);
+
+  // The bursts are spread over the messages.
+  auto count_list = CountFrames(frame_list);
+  EXPECT_GT(count_list[256], 200);
+  EXPECT_GT(count_list[512], 200);
+  remove(dbc_path);
+}
+
+}  // namespace bus::test
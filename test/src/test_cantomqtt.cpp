@@ -5,14 +5,38 @@
 
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
 #include <util/logconfig.h>
 #include <util/logstream.h>
 #include "bus/cantomqtt.h"
+#include "bus/configreader.h"
 #include "bus/buslogstream.h"
 #include <metric/metriclogstream.h>
 
 using namespace util::log;
 using namespace metric;
+using namespace std::filesystem;
+
+namespace {
+
+// The DBC file doesn't exist, so none of the selections are resolved.
+constexpr std::string_view kUnresolvedConfig = R"(<?xml version="1.0"?>
+<CanToMqtt>
+  <DbcFiles>
+    <DbcFile name='missing_vehicle.dbc'/>
+  </DbcFiles>
+  <SelectedItems>
+    <Metric name='Speed' msg_id='256' msg_name='Vehicle'/>
+    <Metric name='Renamed' msg_id='512' msg_name='Battery'/>
+    <Rule min_id='0x300' max_id='0x3FF' signal='*Temp'/>
+  </SelectedItems>
+</CanToMqtt>
+)";
+
+}  // namespace
 
 namespace bus::test {
 
@@ -31,4 +55,32 @@ TEST(TestCanToMqtt, TestLogger) {
   log_config.DeleteLogChain();
 }
 
-}
\ No newline at end of file
+TEST(TestCanToMqtt, TestSaveUnresolvedSelection) {
+  const path config_file = temp_directory_path() / "test_unresolved.xml";
+  const path saved_file = temp_directory_path() / "test_unresolved_save.xml";
+  {
+    std::ofstream file(config_file);
+    file << kUnresolvedConfig;
+  }
+
+  CanToMqtt server;
+  server.ConfigFile(config_file.string());
+  ASSERT_TRUE(server.ReadConfigFile());
+  server.ConfigFile(saved_file.string());
+  ASSERT_TRUE(server.SaveConfigFile());
+
+  // The explicit selections survive although no DBC signal was found.
+  ConfigReader config;
+  ASSERT_TRUE(config.ParseFile(saved_file.string()));
+  const auto& selection = config.Selection();
+  EXPECT_EQ(selection.NofSignals(), 2);
+  EXPECT_EQ(selection.NofRules(), 1);
+  EXPECT_TRUE(selection.IsSignalSelected(256, "Vehicle", "", "Speed"));
+  EXPECT_TRUE(selection.IsSignalSelected(512, "Battery", "", "Renamed"));
+  EXPECT_EQ(selection.MessageName(512), "Battery");
+
+  remove(config_file);
+  remove(saved_file);
+}
+
+}  // namespace bus::test
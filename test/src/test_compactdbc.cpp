@@ -0,0 +1,245 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+
+#include <dbc/dbcfile.h>
+
+#include "bus/compactdbc.h"
+
+using namespace std::filesystem;
+
+namespace {
+
+// Message 512 uses extended multiplexing. SignalC depends on SubMux.
+constexpr std::string_view kMuxDbc = R"(VERSION ""
+
+NS_ :
+
+BS_:
+
+BU_: ECU
+
+BO_ 256 Muxed: 8 ECU
+ SG_ Mux M : 0|8@1+ (1,0) [0|255] "" Vector__XXX
+ SG_ SignalA m1 : 8|8@1+ (1,0) [0|255] "" Vector__XXX
+ SG_ SignalB m2 : 8|8@1+ (1,0) [0|255] "" Vector__XXX
+
+BO_ 512 ExtendedMuxed: 8 ECU
+ SG_ Mux M : 0|8@1+ (1,0) [0|255] "" Vector__XXX
+ SG_ SubMux m1M : 8|8@1+ (1,0) [0|255] "" Vector__XXX
+ SG_ SignalC m3 : 16|8@1+ (1,0) [0|255] "" Vector__XXX
+ SG_ Plain : 24|8@1+ (1,0) [0|255] "" Vector__XXX
+
+SG_MUL_VAL_ 512 SubMux Mux 1-1;
+SG_MUL_VAL_ 512 SignalC SubMux 3-3;
+)";
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestCompactDbc, TestStringArena) {
+  StringArena arena;
+  const auto text1 = arena.Intern("EngineSpeed");
+  const auto text2 = arena.Intern(std::string("EngineSpeed"));
+  EXPECT_EQ(text1, "EngineSpeed");
+  EXPECT_EQ(text1.data(), text2.data());
+  EXPECT_TRUE(arena.Intern("").empty());
+
+  const std::string long_text(100'000, 'A');
+  EXPECT_EQ(arena.Intern(long_text), long_text);
+  EXPECT_EQ(text1, "EngineSpeed");
+  EXPECT_GT(arena.MemoryUsage(), long_text.size());
+}
+
+TEST(TestCompactDbc, TestEnumTable) {
+  CompactDbc dbc;
+  auto& strings = dbc.Strings();
+  EnumTable table1 = {{1, strings.Intern("On")}, {0, strings.Intern("Off")}};
+  EnumTable table2 = {{0, strings.Intern("Off")}, {1, strings.Intern("On")}};
+  const int32_t index1 = dbc.AddEnumTable(table1);
+  const int32_t index2 = dbc.AddEnumTable(table2);
+  EXPECT_GE(index1, 0);
+  EXPECT_EQ(index1, index2);
+  EXPECT_EQ(dbc.NofEnumTables(), 1);
+  EXPECT_EQ(dbc.AddEnumTable({}), -1);
+}
+
+TEST(TestCompactDbc, TestDecode) {
+  CompactDbc dbc;
+  auto& strings = dbc.Strings();
+
+  CompactMessage message;
+  message.ident = 100;
+  message.name = strings.Intern("TestMessage");
+
+  CompactSignal intel;
+  intel.name = strings.Intern("Intel");
+  intel.start_bit = 4;
+  intel.bit_length = 12;
+  intel.scale = 0.5;
+  intel.offset = 10;
+  message.signal_list.push_back(intel);
+
+  CompactSignal motorola;
+  motorola.name = strings.Intern("Motorola");
+  motorola.start_bit = 23;
+  motorola.bit_length = 16;
+  motorola.little_endian = false;
+  motorola.data_type = RawDataType::Signed;
+  message.signal_list.push_back(motorola);
+
+  CompactSignal mux;
+  mux.name = strings.Intern("Mux");
+  mux.start_bit = 56;
+  mux.bit_length = 8;
+  mux.mux = RawMuxType::Multiplexor;
+  message.signal_list.push_back(mux);
+
+  CompactSignal muxed;
+  muxed.name = strings.Intern("Muxed");
+  muxed.start_bit = 40;
+  muxed.bit_length = 8;
+  muxed.mux = RawMuxType::Multiplexed;
+  muxed.mux_value = 2;
+  muxed.enum_index = dbc.AddEnumTable({{5, strings.Intern("Five")}});
+  message.signal_list.push_back(muxed);
+
+  const auto* added = dbc.AddMessage(std::move(message));
+  ASSERT_TRUE(added != nullptr);
+  EXPECT_EQ(added->multiplexor, 2);
+  EXPECT_TRUE(dbc.AddMessage(CompactMessage{.ident = 100}) == nullptr);
+  EXPECT_EQ(dbc.GetMessage(100), added);
+  EXPECT_EQ(dbc.NofSignals(), 4);
+  dbc.Finalize();
+
+  // Intel raw 0x123 in bit 4..15. Motorola 0xFF00 (-256) in byte 2..3.
+  std::array<uint8_t, 8> data = {0x30, 0x12, 0xFF, 0x00, 0, 5, 0, 2};
+
+  double intel_value = 0;
+  EXPECT_TRUE(dbc.EngValue(*added, added->signal_list[0], data,
+                           intel_value));
+  EXPECT_DOUBLE_EQ(intel_value, 0x123 * 0.5 + 10);
+
+  int64_t motorola_value = 0;
+  EXPECT_TRUE(dbc.EngValue(*added, added->signal_list[1], data,
+                           motorola_value));
+  EXPECT_EQ(motorola_value, -256);
+
+  std::string muxed_value;
+  EXPECT_TRUE(dbc.EngValue(*added, added->signal_list[3], data,
+                           muxed_value));
+  EXPECT_EQ(muxed_value, "Five");
+
+  data[7] = 1;
+  EXPECT_FALSE(dbc.EngValue(*added, added->signal_list[3], data,
+                            muxed_value));
+
+  // Too short message
+  const std::array<uint8_t, 1> short_data = {0x30};
+  EXPECT_FALSE(dbc.EngValue(*added, added->signal_list[0], short_data,
+                            intel_value));
+  EXPECT_GT(dbc.MemoryUsage(), 0);
+}
+
+TEST(TestCompactDbc, TestEncode) {
+  CompactSignal intel;
+  intel.start_bit = 4;
+  intel.bit_length = 12;
+
+  CompactSignal motorola;
+  motorola.start_bit = 23;
+  motorola.bit_length = 16;
+  motorola.little_endian = false;
+  motorola.data_type = RawDataType::Signed;
+
+  std::array<uint8_t, 8> data = {};
+  EXPECT_TRUE(CompactDbc::SetRawValue(intel, data, 0x123));
+  EXPECT_TRUE(CompactDbc::SetRawValue(motorola, data, 0xFF00));
+  const std::array<uint8_t, 8> expected = {0x30, 0x12, 0xFF, 0x00,
+                                           0, 0, 0, 0};
+  EXPECT_EQ(data, expected);
+
+  uint64_t raw = 0;
+  EXPECT_TRUE(CompactDbc::RawValue(motorola, data, raw));
+  EXPECT_EQ(std::bit_cast<int64_t>(raw), -256);
+
+  std::array<uint8_t, 1> short_data = {};
+  EXPECT_FALSE(CompactDbc::SetRawValue(intel, short_data, 1));
+  EXPECT_EQ(short_data[0], 0);
+}
+
+TEST(TestCompactDbc, TestTextPrecision) {
+  CompactDbc dbc;
+  CompactMessage message;
+  message.ident = 300;
+  CompactSignal odometer;
+  odometer.name = dbc.Strings().Intern("Odometer");
+  odometer.bit_length = 32;
+  odometer.scale = 0.25;
+  message.signal_list.push_back(odometer);
+  const auto* added = dbc.AddMessage(std::move(message));
+  ASSERT_TRUE(added != nullptr);
+  dbc.Finalize();
+
+  // More than the 6 digits of a default stream.
+  std::array<uint8_t, 8> data = {};
+  EXPECT_TRUE(CompactDbc::SetRawValue(added->signal_list[0], data,
+                                      4'938'271));
+  std::string text;
+  EXPECT_TRUE(dbc.EngValue(*added, added->signal_list[0], data, text));
+  EXPECT_EQ(text, "1234567.75");
+}
+
+TEST(TestCompactDbc, TestExtendedMux) {
+  const path dbc_path = temp_directory_path() / "test_compactdbc.dbc";
+  {
+    std::ofstream file(dbc_path);
+    file << kMuxDbc;
+  }
+  dbc::DbcFile dbc_file;
+  dbc_file.Filename(dbc_path.string());
+  ASSERT_TRUE(dbc_file.ParseFile()) << dbc_file.LastError();
+  const auto* network = dbc_file.GetNetwork();
+  ASSERT_TRUE(network != nullptr);
+  const auto& message_list = network->Messages();
+
+  // Plain multiplexing is supported.
+  const auto muxed = message_list.find(256);
+  ASSERT_TRUE(muxed != message_list.cend());
+  EXPECT_FALSE(HasExtendedMux(muxed->second));
+  CompactDbc dbc;
+  for (const auto& [name, signal] : muxed->second.Signals()) {
+    EXPECT_TRUE(IsSupportedSignal(signal, false)) << name;
+    const auto compact = MakeCompactSignal(signal, dbc);
+    if (name == "Mux") {
+      EXPECT_EQ(compact.mux, RawMuxType::Multiplexor);
+    } else {
+      EXPECT_EQ(compact.mux, RawMuxType::Multiplexed);
+      EXPECT_EQ(compact.mux_value, name == "SignalA" ? 1 : 2);
+    }
+  }
+
+  // The multiplexed signals are skipped with extended multiplexing.
+  const auto extended = message_list.find(512);
+  ASSERT_TRUE(extended != message_list.cend());
+  const bool extended_mux = HasExtendedMux(extended->second);
+  EXPECT_TRUE(extended_mux);
+  const auto& signal_list = extended->second.Signals();
+  EXPECT_TRUE(IsSupportedSignal(signal_list.at("Mux"), extended_mux));
+  EXPECT_FALSE(IsSupportedSignal(signal_list.at("SubMux"), extended_mux));
+  EXPECT_FALSE(IsSupportedSignal(signal_list.at("SignalC"), extended_mux));
+  EXPECT_TRUE(IsSupportedSignal(signal_list.at("Plain"), extended_mux));
+
+  remove(dbc_path);
+}
+
+}
@@ -0,0 +1,150 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <util/ixmlfile.h>
+
+#include "bus/configreader.h"
+
+using namespace std::filesystem;
+
+namespace {
+
+constexpr std::string_view kConfig = R"(<?xml version="1.0"?>
+<CanToMqtt>
+  <BrokerHost>broker.local</BrokerHost>
+  <BrokerPort>1884</BrokerPort>
+  <Retain>true</Retain>
+  <TopicPrefix> Fleet/Truck1 </TopicPrefix>
+  <CaptureBufferSize> -1</CaptureBufferSize>
+  <InFlightWindow>-128</InFlightWindow>
+  <CompressionLevel>-5</CompressionLevel>
+  <DbcFiles>
+    <DbcFile name='engine.dbc'>
+      <FileName>engine.dbc</FileName>
+    </DbcFile>
+    <DbcFile>
+      <FileName>battery.dbc</FileName>
+    </DbcFile>
+  </DbcFiles>
+  <SelectedItems>
+    <Metric name='Speed' msg_id='256' msg_name='Vehicle'/>
+    <Metric name='Odometer' msg_id='0x100' msg_name='Vehicle'/>
+    <Rule min_id='0x200' max_id='0x2FF' node='BMS*' signal='*Temp'/>
+  </SelectedItems>
+  <Triggers>
+    <Trigger name='OverTemp' condition='BatteryTemp > 60 &amp;&amp; Speed > 0'
+             pre='10' post='2.5' signals='BatteryTemp, Speed,Current'/>
+    <Trigger name='NoCondition'/>
+  </Triggers>
+</CanToMqtt>
+)";
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestConfigReader, TestParseFile) {
+  const path config_file = temp_directory_path() / "test_configreader.xml";
+  {
+    std::ofstream file(config_file);
+    file << kConfig;
+  }
+
+  ConfigReader config;
+  ASSERT_TRUE(config.ParseFile(config_file.string()));
+  EXPECT_EQ(config.Property<std::string>("BrokerHost"), "broker.local");
+  EXPECT_EQ(config.Property<uint16_t>("BrokerPort", 1883), 1884);
+  EXPECT_EQ(config.Property<uint16_t>("BusPort", 0), 0);
+  EXPECT_TRUE(config.Property<bool>("Retain", false));
+  EXPECT_EQ(config.Property<std::string>("TopicPrefix"), "Fleet/Truck1");
+  // Negative values are invalid for unsigned properties.
+  EXPECT_EQ(config.Property<size_t>("CaptureBufferSize", 4096), 4096);
+  EXPECT_EQ(config.Property<uint16_t>("InFlightWindow", 256), 256);
+  EXPECT_EQ(config.Property<int>("CompressionLevel", 3), -5);
+
+  ASSERT_EQ(config.DbcFiles().size(), 2);
+  EXPECT_EQ(config.DbcFiles()[0], "engine.dbc");
+  EXPECT_EQ(config.DbcFiles()[1], "battery.dbc");
+
+  const auto& selection = config.Selection();
+  EXPECT_EQ(selection.NofSignals(), 2);
+  EXPECT_EQ(selection.NofRules(), 1);
+  EXPECT_TRUE(selection.IsSignalSelected(256, "Vehicle", "", "Odometer"));
+  EXPECT_TRUE(selection.IsSignalSelected(0x210, "Battery", "BMS", "CellTemp"));
+
+  ASSERT_EQ(config.Triggers().size(), 1);
+  const auto& trigger = config.Triggers().front();
+  EXPECT_EQ(trigger.name, "OverTemp");
+  EXPECT_EQ(trigger.condition, "BatteryTemp > 60 && Speed > 0");
+  EXPECT_DOUBLE_EQ(trigger.pre_time, 10.0);
+  EXPECT_DOUBLE_EQ(trigger.post_time, 2.5);
+  ASSERT_EQ(trigger.signal_list.size(), 3);
+  EXPECT_EQ(trigger.signal_list[1], "Speed");
+
+  remove(config_file);
+  EXPECT_FALSE(config.ParseFile(config_file.string()));
+}
+
+TEST(TestConfigReader, TestWriteFile) {
+  const path config_file = temp_directory_path() / "test_configwriter.xml";
+  {
+    auto xml_file = util::xml::CreateXmlFile("FileWriter");
+    ASSERT_TRUE(xml_file);
+    auto& root_node = xml_file->RootName("CanToMqtt");
+    xml_file->FileName(config_file.string());
+    root_node.SetProperty("BrokerHost", std::string("broker.local"));
+
+    ConfigReader::WriteDbcFiles(root_node, {"engine.dbc", "", "bms.dbc"});
+    auto& items_node = ConfigReader::WriteSelectedItems(root_node);
+    SelectionRule rule;
+    rule.min_ident = 0x200;
+    rule.max_ident = 0x2FF;
+    rule.node = GlobPattern("BMS*");
+    rule.signal = GlobPattern("*Temp");
+    ConfigReader::WriteRule(items_node, rule);
+    ConfigReader::WriteMetric(items_node, 256, "Vehicle", "Speed");
+
+    TriggerConfig trigger;
+    trigger.name = "OverTemp";
+    trigger.condition = "BatteryTemp > 60 && Speed > 0";
+    trigger.pre_time = 5.0;
+    trigger.post_time = 2.5;
+    trigger.signal_list = {"BatteryTemp", "Current"};
+    ConfigReader::WriteTriggers(root_node, {trigger});
+    ASSERT_TRUE(xml_file->WriteFile());
+  }
+
+  // The reader reads what the writer writes.
+  ConfigReader config;
+  ASSERT_TRUE(config.ParseFile(config_file.string()));
+  EXPECT_EQ(config.Property<std::string>("BrokerHost"), "broker.local");
+  ASSERT_EQ(config.DbcFiles().size(), 2);
+  EXPECT_EQ(config.DbcFiles()[1], "bms.dbc");
+
+  const auto& selection = config.Selection();
+  EXPECT_EQ(selection.NofSignals(), 1);
+  EXPECT_EQ(selection.NofRules(), 1);
+  EXPECT_TRUE(selection.IsSignalSelected(256, "Vehicle", "", "Speed"));
+  EXPECT_TRUE(selection.IsSignalSelected(0x210, "Battery", "BMS", "CellTemp"));
+  EXPECT_FALSE(selection.IsSignalSelected(0x310, "Battery", "BMS",
+                                          "CellTemp"));
+
+  ASSERT_EQ(config.Triggers().size(), 1);
+  const auto& trigger = config.Triggers().front();
+  EXPECT_EQ(trigger.condition, "BatteryTemp > 60 && Speed > 0");
+  EXPECT_DOUBLE_EQ(trigger.pre_time, 5.0);
+  EXPECT_DOUBLE_EQ(trigger.post_time, 2.5);
+  ASSERT_EQ(trigger.signal_list.size(), 2);
+  EXPECT_EQ(trigger.signal_list[1], "Current");
+
+  remove(config_file);
+}
+
+}
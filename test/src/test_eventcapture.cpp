@@ -0,0 +1,201 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bus/eventcapture.h"
+#include "bus/signalringbuffer.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr uint64_t kSecond = 1'000'000'000;
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestEventCapture, TestRingBuffer) {
+  SignalRingBuffer buffer(5);
+  EXPECT_EQ(buffer.Capacity(), 8);
+
+  std::vector<SignalSample> sample_list;
+  EXPECT_EQ(buffer.Snapshot(0, 100, sample_list), 0);
+
+  for (uint64_t time = 1; time <= 20; ++time) {
+    buffer.Push(time, static_cast<double>(time) * 10.0);
+  }
+  EXPECT_EQ(buffer.NofSamples(), 20);
+
+  // The oldest samples are overwritten.
+  EXPECT_EQ(buffer.Snapshot(0, 100, sample_list), 7);
+  EXPECT_EQ(sample_list.front().timestamp, 14);
+  EXPECT_DOUBLE_EQ(sample_list.back().value, 200.0);
+
+  sample_list.clear();
+  EXPECT_EQ(buffer.Snapshot(15, 16, sample_list), 2);
+}
+
+TEST(TestEventCapture, TestConcurrentRingBuffer) {
+  SignalRingBuffer buffer(64);
+  std::atomic<bool> stop = false;
+  std::thread writer([&] {
+    for (uint64_t time = 1; !stop; ++time) {
+      buffer.Push(time, static_cast<double>(time));
+    }
+  });
+
+  std::vector<SignalSample> sample_list;
+  for (size_t count = 0; count < 1000; ++count) {
+    sample_list.clear();
+    buffer.Snapshot(0, UINT64_MAX, sample_list);
+    for (size_t index = 1; index < sample_list.size(); ++index) {
+      // Consistent samples are in order and the value matches the time.
+      EXPECT_GT(sample_list[index].timestamp,
+                sample_list[index - 1].timestamp);
+      EXPECT_DOUBLE_EQ(sample_list[index].value,
+                       static_cast<double>(sample_list[index].timestamp));
+    }
+  }
+  stop = true;
+  writer.join();
+}
+
+TEST(TestEventCapture, TestTrigger) {
+  EventCapture capture;
+  TriggerConfig config;
+  config.name = "OverTemp";
+  config.condition = "BatteryTemp > 60 && Speed > 0";
+  config.pre_time = 2.0;
+  config.post_time = 1.0;
+  config.signal_list = {"BatteryTemp", "Current"};
+  EXPECT_TRUE(capture.AddTrigger(config));
+
+  TriggerConfig invalid;
+  invalid.name = "Invalid";
+  invalid.condition = "Voltage >";
+  EXPECT_FALSE(capture.AddTrigger(invalid));
+  EXPECT_EQ(capture.Triggers().size(), 1);
+
+  const int32_t temp = capture.BindSignal("Battery", "BatteryTemp");
+  const int32_t speed = capture.BindSignal("Vehicle", "Speed");
+  const int32_t current = capture.BindSignal("Battery", "Current");
+  EXPECT_GE(temp, 0);
+  EXPECT_GE(speed, 0);
+  EXPECT_GE(current, 0);
+  EXPECT_EQ(capture.BindSignal("Other", "Speed"), -1);
+  EXPECT_EQ(capture.BindSignal("Battery", "Voltage"), -1);
+  EXPECT_TRUE(capture.UnboundSignals().empty());
+
+  std::mutex payload_mutex;
+  std::vector<std::string> payload_list;
+  EXPECT_TRUE(capture.Start([&] (const std::string& trigger,
+                                 std::string payload) {
+    EXPECT_EQ(trigger, "OverTemp");
+    std::scoped_lock lock(payload_mutex);
+    payload_list.emplace_back(std::move(payload));
+  }));
+
+  // 10 samples per second. The temperature exceeds the limit after 5 s.
+  for (uint64_t sample = 0; sample < 100; ++sample) {
+    const uint64_t time = sample * kSecond / 10;
+    capture.OnValue(temp, time, sample < 50 ? 20.0 : 70.0);
+    capture.OnValue(speed, time, 10.0);
+    capture.OnValue(current, time, static_cast<double>(sample));
+    capture.Evaluate(time);
+  }
+  EXPECT_EQ(capture.NofTriggered(), 1);
+
+  for (size_t wait = 0; wait < 100 && capture.NofPublished() == 0; ++wait) {
+    std::this_thread::sleep_for(10ms);
+  }
+  capture.Stop();
+  ASSERT_EQ(payload_list.size(), 1);
+  const auto& payload = payload_list.front();
+  EXPECT_NE(payload.find("\"trigger\":\"OverTemp\""), std::string::npos);
+  EXPECT_NE(payload.find("\"timestamp\":5000000000"), std::string::npos);
+  EXPECT_NE(payload.find("\"Current\":{\"timestamps\":[3000000000,"),
+            std::string::npos);
+  EXPECT_NE(payload.find(",6000000000],\"values\":[30,"), std::string::npos);
+  EXPECT_EQ(payload.find("\"Speed\""), std::string::npos);
+}
+
+TEST(TestEventCapture, TestQuietBus) {
+  EventCapture capture;
+  TriggerConfig config;
+  config.name = "Fault/Active";
+  config.condition = "Fault == 1";
+  config.pre_time = 1.0;
+  config.post_time = 0.1;
+  EXPECT_TRUE(capture.AddTrigger(config));
+  const int32_t fault = capture.BindSignal("Ecu", "Fault");
+  ASSERT_GE(fault, 0);
+
+  std::mutex payload_mutex;
+  std::vector<std::string> payload_list;
+  EXPECT_TRUE(capture.Start([&] (const std::string& trigger,
+                                 std::string payload) {
+    EXPECT_EQ(trigger, "Fault/Active");
+    std::scoped_lock lock(payload_mutex);
+    payload_list.emplace_back(std::move(payload));
+  }));
+
+  // No frames are received after the trigger.
+  capture.OnValue(fault, kSecond, 0.0);
+  capture.Evaluate(kSecond);
+  capture.OnValue(fault, 2 * kSecond, 1.0);
+  capture.Evaluate(2 * kSecond);
+  EXPECT_EQ(capture.NofTriggered(), 1);
+
+  for (size_t wait = 0; wait < 500 && capture.NofPublished() == 0; ++wait) {
+    std::this_thread::sleep_for(10ms);
+  }
+  EXPECT_EQ(capture.NofPublished(), 1);
+  capture.Stop();
+  ASSERT_EQ(payload_list.size(), 1);
+  EXPECT_NE(payload_list.front().find("\"values\":[0,1]"),
+            std::string::npos);
+}
+
+TEST(TestEventCapture, TestStopFlush) {
+  EventCapture capture;
+  TriggerConfig config;
+  config.name = "Over\tTemp";
+  config.condition = "Temp > 60";
+  config.post_time = 100.0;
+  EXPECT_TRUE(capture.AddTrigger(config));
+  const int32_t temp = capture.BindSignal("Battery", "Temp");
+  ASSERT_GE(temp, 0);
+
+  std::vector<std::string> payload_list;
+  EXPECT_TRUE(capture.Start([&] (const std::string&, std::string payload) {
+    payload_list.emplace_back(std::move(payload));
+  }));
+  capture.OnValue(temp, kSecond, 70.0);
+  capture.Evaluate(kSecond);
+  capture.OnValue(temp, 2 * kSecond,
+                  std::numeric_limits<double>::infinity());
+  capture.Evaluate(2 * kSecond);
+
+  // The pending capture is published when the capture stops.
+  capture.Stop();
+  EXPECT_EQ(capture.NofPublished(), 1);
+  ASSERT_EQ(payload_list.size(), 1);
+  const auto& payload = payload_list.front();
+  EXPECT_NE(payload.find("\"trigger\":\"Over\\tTemp\""),
+            std::string::npos);
+  EXPECT_NE(payload.find("\"values\":[70,null]"), std::string::npos);
+}
+
+}
@@ -0,0 +1,60 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "bus/jsonwriter.h"
+
+namespace bus::test {
+
+TEST(TestJsonWriter, TestString) {
+  std::string json;
+  AddJsonString(json, "Speed");
+  EXPECT_EQ(json, "\"Speed\"");
+
+  json.clear();
+  AddJsonString(json, "a\"b\\c");
+  EXPECT_EQ(json, R"("a\"b\\c")");
+
+  json.clear();
+  AddJsonString(json, std::string("\n\r\t\b\f\x01\x1F", 7));
+  EXPECT_EQ(json, R"("\n\r\t\b\f\u0001\u001f")");
+
+  std::ostringstream stream;
+  AddJsonString(stream, "Line\nFeed");
+  EXPECT_EQ(stream.str(), R"("Line\nFeed")");
+}
+
+TEST(TestJsonWriter, TestNumber) {
+  std::string json;
+  AddJsonNumber(json, uint64_t{1'700'000'000'000'000'000});
+  EXPECT_EQ(json, "1700000000000000000");
+
+  json.clear();
+  AddJsonNumber(json, 1.5);
+  EXPECT_EQ(json, "1.5");
+
+  // The payloads keep all significant digits.
+  std::ostringstream stream;
+  AddJsonNumber(stream, 1234567.8);
+  stream << ',';
+  AddJsonNumber(stream, 57.7089123);
+  EXPECT_EQ(stream.str(), "1234567.8,57.7089123");
+
+  json.clear();
+  AddJsonNumber(json, std::numeric_limits<double>::infinity());
+  EXPECT_EQ(json, "null");
+
+  json.clear();
+  AddJsonNumber(json, std::nan(""));
+  EXPECT_EQ(json, "null");
+}
+
+}  // namespace bus::test
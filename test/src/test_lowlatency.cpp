@@ -0,0 +1,111 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#include "bus/configreader.h"
+#include "bus/lowlatency.h"
+
+using namespace std::filesystem;
+using namespace std::chrono_literals;
+
+namespace {
+
+bool WriteConfig(const path& filename, std::string_view config) {
+  std::ofstream file(filename);
+  file << config;
+  return file.good();
+}
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestLowLatency, TestReadConfig) {
+  const path config_file = temp_directory_path() / "test_lowlatency.xml";
+  ASSERT_TRUE(WriteConfig(config_file, R"(<?xml version="1.0"?>
+<CanToMqtt>
+  <LowLatency>true</LowLatency>
+  <CpuCore>3</CpuCore>
+  <BusyPoll>true</BusyPoll>
+  <RealTimePriority>80</RealTimePriority>
+  <LockMemory>true</LockMemory>
+</CanToMqtt>
+)"));
+  ConfigReader config;
+  ASSERT_TRUE(config.ParseFile(config_file.string()));
+  const auto low_latency = ReadLowLatencyConfig(config);
+  EXPECT_TRUE(low_latency.enabled);
+  EXPECT_EQ(low_latency.cpu_core, 3);
+  EXPECT_TRUE(low_latency.busy_poll);
+  EXPECT_EQ(low_latency.realtime_priority, 80);
+  EXPECT_TRUE(low_latency.lock_memory);
+
+  // Missing properties gives the defaults.
+  ASSERT_TRUE(WriteConfig(config_file, R"(<?xml version="1.0"?>
+<CanToMqtt>
+  <BrokerHost>localhost</BrokerHost>
+</CanToMqtt>
+)"));
+  ASSERT_TRUE(config.ParseFile(config_file.string()));
+  const auto defaults = ReadLowLatencyConfig(config);
+  EXPECT_FALSE(defaults.enabled);
+  EXPECT_EQ(defaults.cpu_core, -1);
+  EXPECT_FALSE(defaults.busy_poll);
+  EXPECT_EQ(defaults.realtime_priority, 0);
+  EXPECT_FALSE(defaults.lock_memory);
+
+  // Out of range values are limited.
+  ASSERT_TRUE(WriteConfig(config_file, R"(<?xml version="1.0"?>
+<CanToMqtt>
+  <LowLatency>true</LowLatency>
+  <CpuCore>-5</CpuCore>
+  <RealTimePriority>150</RealTimePriority>
+</CanToMqtt>
+)"));
+  ASSERT_TRUE(config.ParseFile(config_file.string()));
+  const auto limited = ReadLowLatencyConfig(config);
+  EXPECT_EQ(limited.cpu_core, -1);
+  EXPECT_EQ(limited.realtime_priority, 99);
+
+  remove(config_file);
+}
+
+TEST(TestLowLatency, TestBackoff) {
+  // The first empty polls spin or yield.
+  EXPECT_EQ(BusyPollSleepTime(0), 0us);
+  EXPECT_EQ(BusyPollSleepTime(64), 0us);
+
+  // An idle bus ends up in a bounded sleep.
+  std::chrono::microseconds last_sleep = 0us;
+  for (uint32_t polls = 0; polls < 10'000; ++polls) {
+    const auto sleep_time = BusyPollSleepTime(polls);
+    EXPECT_GE(sleep_time, last_sleep);
+    EXPECT_LE(sleep_time, 1ms);
+    last_sleep = sleep_time;
+  }
+  EXPECT_GT(last_sleep, 0us);
+  EXPECT_EQ(BusyPollSleepTime(UINT32_MAX), last_sleep);
+
+  // The spin phase is short while the sleep phase gives up the CPU.
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t polls = 0; polls < 64; ++polls) {
+    BusyPollBackoff(polls);
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 100ms);
+
+  start = std::chrono::steady_clock::now();
+  for (int count = 0; count < 10; ++count) {
+    BusyPollBackoff(UINT32_MAX);
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 10 * last_sleep);
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "mqttbrokerstub.h"
+
+using namespace std::chrono_literals;
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+namespace {
+
+bool WaitFor(const std::function<bool()>& condition) {
+  const auto timeout = std::chrono::steady_clock::now() + 10s;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > timeout) {
+      return false;
+    }
+    std::this_thread::sleep_for(10ms);
+  }
+  return true;
+}
+
+uint64_t NowNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<
+    std::chrono::nanoseconds>(std::chrono::system_clock::now()
+      .time_since_epoch()).count());
+}
+
+/** \brief MQTT 3.1.1 CONNECT packet. */
+std::string MakeConnect() {
+  return {"\x10\x10\x00\x04MQTT\x04\x02\x00\x3C\x00\x04test", 18};
+}
+
+/** \brief MQTT 3.1.1 PUBLISH packet. QoS 1 if the packet id isn't 0. */
+std::string MakePublish(const std::string& payload, uint16_t packet_id) {
+  std::string packet;
+  packet += packet_id > 0 ? '\x32' : '\x30';
+  const size_t length = 2 + 4 + (packet_id > 0 ? 2 : 0) + payload.size();
+  packet += static_cast<char>(length); // Less than 128 bytes
+  packet += std::string("\x00\x04Test", 6);
+  if (packet_id > 0) {
+    packet += static_cast<char>(packet_id >> 8);
+    packet += static_cast<char>(packet_id & 0xFF);
+  }
+  packet += payload;
+  return packet;
+}
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestMqttBrokerStub, TestPublish) {
+  MqttBrokerStub broker;
+  broker.Port(0);
+  broker.TrackTimestamps(true);
+  ASSERT_TRUE(broker.Start());
+  ASSERT_GT(broker.Port(), 0);
+
+  asio::io_context context;
+  tcp::socket socket(context);
+  socket.connect(tcp::endpoint(asio::ip::address_v4::loopback(),
+                               broker.Port()));
+  asio::write(socket, asio::buffer(MakeConnect()));
+  std::array<uint8_t, 4> connack {};
+  asio::read(socket, asio::buffer(connack));
+  EXPECT_EQ(connack[0], 0x20);
+  EXPECT_TRUE(WaitFor([&] { return broker.NofConnections() == 1; }));
+
+  // The payload timestamp gives the latency and identifies the frame.
+  const uint64_t timestamp = NowNs() - 1'000'000;
+  const std::string payload = "{\"timestamp\":" + std::to_string(timestamp)
+                            + ",\"value\":1}";
+  asio::write(socket, asio::buffer(MakePublish(payload, 1)));
+  std::array<uint8_t, 4> puback {};
+  asio::read(socket, asio::buffer(puback));
+  EXPECT_EQ(puback[0], 0x40);
+  EXPECT_EQ(puback[3], 1);
+
+  // A payload without a timestamp is only counted.
+  asio::write(socket, asio::buffer(MakePublish("{\"value\":2}", 0)));
+  EXPECT_TRUE(WaitFor([&] { return broker.NofPublishes() == 2; }));
+  EXPECT_EQ(broker.NofBytes(), payload.size() + 11);
+
+  std::vector<int64_t> latency_list;
+  broker.TakeLatencies(latency_list);
+  ASSERT_EQ(latency_list.size(), 1);
+  EXPECT_GE(latency_list[0], 1'000'000);
+
+  std::vector<uint64_t> timestamp_list;
+  broker.TakeTimestamps(timestamp_list);
+  ASSERT_EQ(timestamp_list.size(), 1);
+  EXPECT_EQ(timestamp_list[0], timestamp);
+  broker.TakeTimestamps(timestamp_list);
+  EXPECT_TRUE(timestamp_list.empty());
+
+  socket.close();
+  broker.Stop();
+}
+
+}  // namespace bus::test
@@ -0,0 +1,316 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "bus/mqttpublisher.h"
+#include "mqttbrokerstub.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+/** \brief Waits until the condition is true or a timeout. */
+bool WaitFor(const std::function<bool()>& condition) {
+  const auto timeout = std::chrono::steady_clock::now() + 10s;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > timeout) {
+      return false;
+    }
+    std::this_thread::sleep_for(10ms);
+  }
+  return true;
+}
+
+bus::PublishMessage MakeMessage(size_t index) {
+  bus::PublishMessage message;
+  message.topic = "CanMetrics/Test/" + std::to_string(index % 4);
+  message.payload = "{\"index\":" + std::to_string(index) + "}";
+  message.content_type = "application/json";
+  return message;
+}
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestMqttPublisher, TestProperties) {
+  MqttPublisher publisher;
+  EXPECT_EQ(publisher.Qos(), PublishQos::AtLeastOnce);
+  EXPECT_GT(publisher.InFlightWindow(), 1);
+
+  publisher.Host("broker.local");
+  publisher.Port(1884);
+  publisher.Qos(PublishQos::ExactlyOnce);
+  publisher.InFlightWindow(1024);
+  publisher.MaxQueueSize(10);
+
+  EXPECT_EQ(publisher.Host(), "broker.local");
+  EXPECT_EQ(publisher.Port(), 1884);
+  EXPECT_EQ(publisher.Qos(), PublishQos::ExactlyOnce);
+  EXPECT_EQ(publisher.InFlightWindow(), 1024);
+  EXPECT_EQ(publisher.MaxQueueSize(), 10);
+
+  // At least one message must be in flight.
+  publisher.InFlightWindow(0);
+  EXPECT_EQ(publisher.InFlightWindow(), 1);
+}
+
+TEST(TestMqttPublisher, TestPublishWhenStopped) {
+  MqttPublisher publisher;
+  EXPECT_FALSE(publisher.IsStarted());
+
+  PublishMessage message;
+  message.topic = "CanMetrics/Test";
+  message.payload = "{}";
+  EXPECT_FALSE(publisher.Publish(message));
+  EXPECT_EQ(publisher.NofPublished(), 0);
+  EXPECT_EQ(publisher.QueueSize(), 0);
+  publisher.Stop();
+}
+
+TEST(TestMqttPublisher, TestTransportLayer) {
+  MqttPublisher publisher;
+  EXPECT_EQ(publisher.Transport(), metric::TransportLayer::MqttTcp);
+  publisher.Transport(metric::TransportLayer::MqttTcpTls);
+  EXPECT_FALSE(publisher.Start());
+  EXPECT_FALSE(publisher.IsStarted());
+}
+
+TEST(TestMqttPublisher, TestInFlightWindow) {
+  MqttBrokerStub broker;
+  broker.Port(0);
+  ASSERT_TRUE(broker.Start());
+  broker.HoldAcks(true);
+
+  MqttPublisher publisher;
+  publisher.Port(broker.Port());
+  publisher.ClientId("TestInFlightWindow");
+  publisher.InFlightWindow(4);
+  ASSERT_TRUE(publisher.Start());
+
+  constexpr size_t kNofMessages = 20;
+  for (size_t index = 0; index < kNofMessages; ++index) {
+    EXPECT_TRUE(publisher.Publish(MakeMessage(index)));
+  }
+
+  // No acknowledges. Only the window is sent to the broker.
+  EXPECT_TRUE(WaitFor([&] { return broker.NofPublishes() == 4; }));
+  std::this_thread::sleep_for(100ms);
+  EXPECT_EQ(broker.NofPublishes(), 4);
+  EXPECT_EQ(publisher.InFlight(), 4);
+  EXPECT_EQ(publisher.QueueSize(), kNofMessages - 4);
+  EXPECT_EQ(publisher.NofCompleted(), 0);
+
+  // The acknowledges drain the queue.
+  broker.HoldAcks(false);
+  EXPECT_TRUE(WaitFor([&] {
+    return publisher.NofCompleted() == kNofMessages;
+  }));
+  EXPECT_EQ(publisher.InFlight(), 0);
+  EXPECT_EQ(publisher.QueueSize(), 0);
+  EXPECT_EQ(publisher.NofPublished(), kNofMessages);
+  EXPECT_EQ(publisher.NofFailed(), 0);
+  EXPECT_EQ(publisher.NofDropped(), 0);
+  EXPECT_EQ(broker.NofPublishes(), kNofMessages);
+
+  publisher.Stop();
+  broker.Stop();
+}
+
+TEST(TestMqttPublisher, TestQueueOverflow) {
+  MqttBrokerStub broker;
+  broker.Port(0);
+  ASSERT_TRUE(broker.Start());
+  broker.HoldAcks(true);
+
+  MqttPublisher publisher;
+  publisher.Port(broker.Port());
+  publisher.ClientId("TestQueueOverflow");
+  publisher.InFlightWindow(1);
+  publisher.MaxQueueSize(5);
+  ASSERT_TRUE(publisher.Start());
+
+  EXPECT_TRUE(publisher.Publish(MakeMessage(0)));
+  EXPECT_TRUE(WaitFor([&] { return publisher.InFlight() == 1; }));
+
+  size_t nof_accepted = 0;
+  for (size_t index = 1; index <= 10; ++index) {
+    if (publisher.Publish(MakeMessage(index))) {
+      ++nof_accepted;
+    }
+  }
+  EXPECT_EQ(nof_accepted, 5);
+  EXPECT_EQ(publisher.NofDropped(), 5);
+  EXPECT_EQ(publisher.QueueSize(), 5);
+
+  broker.HoldAcks(false);
+  EXPECT_TRUE(WaitFor([&] { return publisher.NofCompleted() == 6; }));
+  EXPECT_EQ(publisher.QueueSize(), 0);
+  EXPECT_EQ(broker.NofPublishes(), 6);
+
+  publisher.Stop();
+  broker.Stop();
+}
+
+TEST(TestMqttPublisher, TestFailedPublishes) {
+  MqttBrokerStub broker;
+  broker.Port(0);
+  ASSERT_TRUE(broker.Start());
+  broker.RejectPublishes(true);
+
+  MqttPublisher publisher;
+  publisher.Port(broker.Port());
+  publisher.ClientId("TestFailedPublishes");
+  ASSERT_TRUE(publisher.Start());
+
+  constexpr size_t kNofMessages = 5;
+  for (size_t index = 0; index < kNofMessages; ++index) {
+    EXPECT_TRUE(publisher.Publish(MakeMessage(index)));
+  }
+  EXPECT_TRUE(WaitFor([&] { return publisher.NofFailed() == kNofMessages; }));
+  EXPECT_EQ(publisher.NofCompleted(), 0);
+  EXPECT_EQ(publisher.InFlight(), 0);
+
+  // Rejected messages doesn't block the following messages.
+  broker.RejectPublishes(false);
+  EXPECT_TRUE(publisher.Publish(MakeMessage(kNofMessages)));
+  EXPECT_TRUE(WaitFor([&] { return publisher.NofCompleted() == 1; }));
+
+  publisher.Stop();
+  broker.Stop();
+}
+
+TEST(TestMqttPublisher, TestTopicAliasTable) {
+  TopicAliasTable table;
+  bool send_topic = false;
+
+  // The topic is sent until the broker has acknowledged the alias.
+  EXPECT_EQ(table.Assign("Topic/A", 2, send_topic), 1);
+  EXPECT_TRUE(send_topic);
+  EXPECT_EQ(table.Assign("Topic/A", 2, send_topic), 1);
+  EXPECT_TRUE(send_topic);
+  table.Confirm(1);
+  EXPECT_EQ(table.Assign("Topic/A", 2, send_topic), 1);
+  EXPECT_FALSE(send_topic);
+  EXPECT_EQ(table.Assign("Topic/B", 2, send_topic), 2);
+  EXPECT_TRUE(send_topic);
+
+  // The topic alias maximum is reached.
+  EXPECT_EQ(table.Assign("Topic/C", 2, send_topic), 0);
+  EXPECT_TRUE(send_topic);
+  EXPECT_EQ(table.Size(), 2);
+  table.Confirm(2);
+  table.Confirm(3); // Unknown alias
+  EXPECT_EQ(table.Assign("Topic/B", 2, send_topic), 2);
+  EXPECT_FALSE(send_topic);
+
+  // No aliases if the broker doesn't accept any.
+  TopicAliasTable no_alias;
+  EXPECT_EQ(no_alias.Assign("Topic/A", 0, send_topic), 0);
+  EXPECT_TRUE(send_topic);
+  EXPECT_EQ(table.Assign("", 2, send_topic), 0);
+  EXPECT_TRUE(send_topic);
+
+  // A new connection sends the full topic again.
+  table.Reset();
+  EXPECT_EQ(table.Size(), 0);
+  EXPECT_EQ(table.Assign("Topic/B", 2, send_topic), 1);
+  EXPECT_TRUE(send_topic);
+  EXPECT_EQ(table.Assign("Topic/B", 2, send_topic), 1);
+  EXPECT_TRUE(send_topic);
+}
+
+TEST(TestMqttPublisher, TestTopicAliasReconnect) {
+  MqttBrokerStub broker;
+  broker.Port(0);
+  ASSERT_TRUE(broker.Start());
+
+  MqttPublisher publisher;
+  publisher.Port(broker.Port());
+  publisher.ClientId("TestTopicAliasReconnect");
+  publisher.TopicAliasMaximum(10);
+  ASSERT_TRUE(publisher.Start());
+  ASSERT_TRUE(WaitFor([&] { return publisher.IsConnected(); }));
+
+  // MakeMessage() uses 4 topics. The first round defines the aliases and
+  // the second round only sends the acknowledged aliases.
+  constexpr size_t kNofMessages = 16;
+  for (size_t round = 1; round <= 2; ++round) {
+    for (size_t index = 0; index < kNofMessages; ++index) {
+      EXPECT_TRUE(publisher.Publish(MakeMessage(index)));
+    }
+    EXPECT_TRUE(WaitFor([&] {
+      return publisher.NofCompleted() == round * kNofMessages;
+    }));
+  }
+  EXPECT_GT(broker.NofAliasPublishes(), 0);
+
+  // The broker forgets the aliases on a new connection.
+  broker.DropConnections();
+  EXPECT_TRUE(WaitFor([&] {
+    return publisher.NofConnects() >= 2 && publisher.IsConnected();
+  }));
+  for (size_t index = 0; index < kNofMessages; ++index) {
+    EXPECT_TRUE(publisher.Publish(MakeMessage(index)));
+  }
+  EXPECT_TRUE(WaitFor([&] {
+    return publisher.NofCompleted() == 3 * kNofMessages;
+  }));
+  EXPECT_EQ(broker.NofAliasErrors(), 0);
+  EXPECT_EQ(publisher.NofFailed(), 0);
+
+  publisher.Stop();
+  broker.Stop();
+}
+
+TEST(TestMqttPublisher, TestTopicAliasInFlightDrop) {
+  MqttBrokerStub broker;
+  broker.Port(0);
+  ASSERT_TRUE(broker.Start());
+
+  MqttPublisher publisher;
+  publisher.Port(broker.Port());
+  publisher.ClientId("TestTopicAliasInFlightDrop");
+  publisher.TopicAliasMaximum(10);
+  ASSERT_TRUE(publisher.Start());
+  ASSERT_TRUE(WaitFor([&] { return publisher.IsConnected(); }));
+
+  // The aliased publishes are in flight when the connection is lost.
+  broker.HoldAcks(true);
+  constexpr size_t kNofMessages = 16;
+  for (size_t index = 0; index < kNofMessages; ++index) {
+    EXPECT_TRUE(publisher.Publish(MakeMessage(index)));
+  }
+  EXPECT_TRUE(WaitFor([&] {
+    return broker.NofPublishes() == kNofMessages;
+  }));
+  EXPECT_EQ(publisher.NofCompleted(), 0);
+
+  broker.DropConnections();
+  broker.HoldAcks(false);
+  EXPECT_TRUE(WaitFor([&] {
+    return publisher.NofConnects() >= 2 && publisher.IsConnected();
+  }));
+  for (size_t index = 0; index < kNofMessages; ++index) {
+    EXPECT_TRUE(publisher.Publish(MakeMessage(index)));
+  }
+  EXPECT_TRUE(WaitFor([&] {
+    return publisher.NofCompleted() + publisher.NofFailed()
+      == 2 * kNofMessages;
+  }));
+  // No alias is used on a connection that hasn't defined it.
+  EXPECT_EQ(broker.NofAliasErrors(), 0);
+
+  publisher.Stop();
+  broker.Stop();
+}
+
+}
@@ -0,0 +1,138 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <zdict.h>
+#include <zstd.h>
+
+#include "bus/payloadcompressor.h"
+
+namespace {
+
+std::string MakePayload(int index) {
+  std::string payload = "{\"timestamp\":" + std::to_string(1'700'000'000 +
+                                                             index);
+  payload += ",\"EngineSpeed\":" + std::to_string(800 + (index * 7) % 3000);
+  payload += ",\"VehicleSpeed\":" + std::to_string((index * 3) % 130);
+  payload += ",\"CoolantTemp\":" + std::to_string(60 + index % 40);
+  payload += ",\"GearPosition\":" + std::to_string(index % 6);
+  payload += "}";
+  return payload;
+}
+
+/** \brief Trains a dictionary in the same way as 'zstd --train'. */
+std::string TrainDictionary() {
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (int index = 0; index < 2000; ++index) {
+    const auto payload = MakePayload(index);
+    samples += payload;
+    sample_sizes.push_back(payload.size());
+  }
+  std::string dictionary(4096, '\0');
+  const size_t size = ZDICT_trainFromBuffer(dictionary.data(),
+    dictionary.size(), samples.data(), sample_sizes.data(),
+    static_cast<unsigned>(sample_sizes.size()));
+  if (ZDICT_isError(size)) {
+    return {};
+  }
+  dictionary.resize(size);
+  return dictionary;
+}
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestPayloadCompressor, TestCompress) {
+  PayloadCompressor compressor;
+  EXPECT_EQ(compressor.DictionaryId(), 0);
+
+  std::string payload = "{\"timestamp\":1234567890";
+  for (int index = 0; index < 50; ++index) {
+    payload += ",\"Signal" + std::to_string(index) + "\":0";
+  }
+  payload += "}";
+
+  std::string output;
+  EXPECT_TRUE(compressor.Compress(payload, output));
+  EXPECT_LT(output.size(), payload.size());
+  EXPECT_EQ(compressor.RawBytes(), payload.size());
+  EXPECT_EQ(compressor.CompressedBytes(), output.size());
+
+  // Too small payloads are not compressed.
+  EXPECT_FALSE(compressor.Compress("{}", output));
+  EXPECT_TRUE(output.empty());
+  EXPECT_EQ(compressor.RawBytes(), payload.size());
+}
+
+TEST(TestPayloadCompressor, TestMissingDictionary) {
+  PayloadCompressor compressor;
+  EXPECT_FALSE(compressor.LoadDictionary("/no/such/dictionary.dict"));
+  EXPECT_TRUE(compressor.LoadDictionary(""));
+  EXPECT_EQ(compressor.DictionaryId(), 0);
+}
+
+TEST(TestPayloadCompressor, TestTrainedDictionary) {
+  const auto dictionary = TrainDictionary();
+  ASSERT_FALSE(dictionary.empty());
+
+  PayloadCompressor compressor;
+  ASSERT_TRUE(compressor.SetDictionary(dictionary));
+  EXPECT_EQ(compressor.DictionaryId(),
+            ZDICT_getDictID(dictionary.data(), dictionary.size()));
+  EXPECT_GT(compressor.DictionaryId(), 0);
+
+  // The consumer decompresses with the same dictionary.
+  const auto payload = MakePayload(12345);
+  std::string output;
+  ASSERT_TRUE(compressor.Compress(payload, output));
+  EXPECT_LT(output.size(), payload.size());
+
+  std::string decompressed(payload.size() * 2, '\0');
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  const size_t size = ZSTD_decompress_usingDict(dctx, decompressed.data(),
+    decompressed.size(), output.data(), output.size(), dictionary.data(),
+    dictionary.size());
+  ZSTD_freeDCtx(dctx);
+  ASSERT_FALSE(ZSTD_isError(size));
+  decompressed.resize(size);
+  EXPECT_EQ(decompressed, payload);
+
+  // The frame holds the dictionary ID.
+  EXPECT_EQ(ZSTD_getDictID_fromFrame(output.data(), output.size()),
+            compressor.DictionaryId());
+}
+
+TEST(TestPayloadCompressor, TestInvalidDictionary) {
+  PayloadCompressor compressor;
+
+  // No zstd dictionary header.
+  EXPECT_FALSE(compressor.SetDictionary("This is not a dictionary"));
+  EXPECT_EQ(compressor.DictionaryId(), 0);
+
+  // Valid header but corrupt entropy tables.
+  auto dictionary = TrainDictionary();
+  ASSERT_GT(dictionary.size(), 64);
+  for (size_t index = 8; index < 64; ++index) {
+    dictionary[index] = static_cast<char>(0xFF);
+  }
+  EXPECT_FALSE(compressor.SetDictionary(dictionary));
+  EXPECT_EQ(compressor.DictionaryId(), 0);
+
+  // The compressor still works without a dictionary.
+  std::string payload;
+  for (int index = 0; index < 20; ++index) {
+    payload += MakePayload(index);
+  }
+  std::string output;
+  EXPECT_TRUE(compressor.Compress(payload, output));
+}
+
+}
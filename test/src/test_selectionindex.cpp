@@ -0,0 +1,81 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include "bus/selectionindex.h"
+
+namespace bus::test {
+
+TEST(TestSelectionIndex, TestGlobPattern) {
+  EXPECT_TRUE(GlobPattern("").Match("Anything"));
+  EXPECT_TRUE(GlobPattern("**").MatchAll());
+
+  const GlobPattern exact("Speed");
+  EXPECT_TRUE(exact.Match("Speed"));
+  EXPECT_FALSE(exact.Match("Speed1"));
+
+  const GlobPattern prefix("Engine*");
+  EXPECT_TRUE(prefix.Match("Engine"));
+  EXPECT_TRUE(prefix.Match("EngineSpeed"));
+  EXPECT_FALSE(prefix.Match("Engin"));
+
+  const GlobPattern suffix("*Temp");
+  EXPECT_TRUE(suffix.Match("BatteryTemp"));
+  EXPECT_FALSE(suffix.Match("BatteryTemp1"));
+
+  const GlobPattern middle("B*ery*T?mp");
+  EXPECT_TRUE(middle.Match("BatteryTemp"));
+  EXPECT_TRUE(middle.Match("BeryTamp"));
+  EXPECT_FALSE(middle.Match("BatteryTem"));
+
+  const GlobPattern single("ECU?");
+  EXPECT_TRUE(single.Match("ECU1"));
+  EXPECT_FALSE(single.Match("ECU12"));
+}
+
+TEST(TestSelectionIndex, TestSelection) {
+  SelectionIndex index;
+  EXPECT_TRUE(index.IsEmpty());
+
+  index.AddSignal(100, "Engine", "Speed");
+  index.AddSignal(100, "Engine", "Speed");
+  index.AddSignal(100, "Engine", "Torque");
+  EXPECT_EQ(index.NofSignals(), 2);
+  EXPECT_EQ(index.MessageName(100), "Engine");
+
+  SelectionRule rule;
+  rule.min_ident = 0x300;
+  rule.max_ident = 0x200;
+  rule.node = GlobPattern("BMS*");
+  rule.signal = GlobPattern("*Temp");
+  index.AddRule(std::move(rule));
+  EXPECT_EQ(index.NofRules(), 1);
+  EXPECT_EQ(index.Rules()[0].min_ident, 0x200);
+
+  EXPECT_TRUE(index.IsMessageSelected(100, "Engine", ""));
+  EXPECT_TRUE(index.IsSignalSelected(100, "Engine", "", "Speed"));
+  EXPECT_FALSE(index.IsSignalSelected(100, "Engine", "", "Rpm"));
+
+  EXPECT_TRUE(index.IsMessageSelected(0x250, "Battery", "BMS1"));
+  EXPECT_FALSE(index.IsMessageSelected(0x250, "Battery", "ECU1"));
+  EXPECT_FALSE(index.IsMessageSelected(0x350, "Battery", "BMS1"));
+  EXPECT_TRUE(index.IsSignalSelected(0x250, "Battery", "BMS1", "CellTemp"));
+  EXPECT_FALSE(index.IsSignalSelected(0x250, "Battery", "BMS1", "Voltage"));
+  EXPECT_TRUE(index.IsRuleSelected(0x250, "Battery", "BMS1", "CellTemp"));
+
+  index.AddSignal(50, "Brake", "Pressure");
+  const auto signal_list = index.Signals();
+  ASSERT_EQ(signal_list.size(), 3);
+  EXPECT_EQ(signal_list[0].ident, 50);
+  EXPECT_EQ(signal_list[0].message_name, "Brake");
+  EXPECT_EQ(signal_list[1].signal_name, "Speed");
+  EXPECT_EQ(signal_list[2].signal_name, "Torque");
+
+  index.Clear();
+  EXPECT_TRUE(index.IsEmpty());
+}
+
+}
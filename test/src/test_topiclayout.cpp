@@ -0,0 +1,50 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include "bus/topiclayout.h"
+
+namespace bus::test {
+
+TEST(TestTopicLayout, TestLayoutString) {
+  for (const auto layout : {TopicLayout::PerMessage, TopicLayout::PerSignal,
+                            TopicLayout::PerNode, TopicLayout::Custom}) {
+    EXPECT_EQ(StringToTopicLayout(TopicLayoutToString(layout)), layout);
+  }
+  EXPECT_EQ(StringToTopicLayout("signal"), TopicLayout::PerSignal);
+  EXPECT_EQ(StringToTopicLayout("Unknown"), TopicLayout::PerMessage);
+}
+
+TEST(TestTopicLayout, TestExpandTemplate) {
+  const auto message_topic = ExpandTopicTemplate(
+    TopicTemplate(TopicLayout::PerMessage, ""),
+    "CanMetrics", "Engine", "EngineData", 100, "");
+  EXPECT_EQ(message_topic, "CanMetrics/EngineData");
+
+  const auto signal_template = TopicTemplate(TopicLayout::PerSignal, "");
+  EXPECT_TRUE(IsSignalTopicTemplate(signal_template));
+  const auto signal_topic = ExpandTopicTemplate(signal_template,
+    "CanMetrics", "Engine", "EngineData", 100, "Speed");
+  EXPECT_EQ(signal_topic, "CanMetrics/EngineData/Speed");
+
+  const auto node_topic = ExpandTopicTemplate(
+    TopicTemplate(TopicLayout::PerNode, ""),
+    "Fleet/Truck1", "", "", 100, "");
+  EXPECT_EQ(node_topic, "Fleet/Truck1/NoNode/100");
+
+  const auto custom_topic = ExpandTopicTemplate(
+    TopicTemplate(TopicLayout::Custom, "{prefix}/{id}/{signal}/{unknown}"),
+    "Can", "Engine", "EngineData", 256, "Speed/+#");
+  EXPECT_EQ(custom_topic, "Can/256/Speed___/{unknown}");
+}
+
+TEST(TestTopicLayout, TestTopicLevel) {
+  EXPECT_EQ(TopicLevel("OverTemp"), "OverTemp");
+  EXPECT_EQ(TopicLevel("Temp/+#"), "Temp___");
+  EXPECT_TRUE(TopicLevel("").empty());
+}
+
+}
@@ -0,0 +1,111 @@
+/*
+* Copyright 2025 Ingemar Hedvall
+* SPDX-License-Identifier: MIT
+*/
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "bus/triggerexpression.h"
+
+namespace {
+
+/** \brief Signal names are added to a list in order of appearance. */
+class Resolver {
+ public:
+  int32_t operator()(std::string_view name) {
+    if (name == "Unknown") {
+      return -1;
+    }
+    for (size_t index = 0; index < name_list_.size(); ++index) {
+      if (name_list_[index] == name) {
+        return static_cast<int32_t>(index);
+      }
+    }
+    name_list_.emplace_back(name);
+    return static_cast<int32_t>(name_list_.size() - 1);
+  }
+  [[nodiscard]] const std::vector<std::string>& Names() const {
+    return name_list_;
+  }
+ private:
+  std::vector<std::string> name_list_;
+};
+
+}  // namespace
+
+namespace bus::test {
+
+TEST(TestTriggerExpression, TestCompare) {
+  Resolver resolver;
+  TriggerExpression expression;
+  EXPECT_TRUE(expression.Compile("BatteryTemp > 60 && Speed > 0",
+    std::ref(resolver)));
+  ASSERT_EQ(resolver.Names().size(), 2);
+  EXPECT_EQ(resolver.Names()[0], "BatteryTemp");
+  EXPECT_EQ(expression.Signals().size(), 2);
+
+  std::array<double, 2> values = {70.0, 10.0};
+  EXPECT_TRUE(expression.IsTrue(values));
+  values[1] = 0.0;
+  EXPECT_FALSE(expression.IsTrue(values));
+  values = {60.0, 10.0};
+  EXPECT_FALSE(expression.IsTrue(values));
+}
+
+TEST(TestTriggerExpression, TestKeywords) {
+  Resolver resolver;
+  TriggerExpression expression;
+  EXPECT_TRUE(expression.Compile(
+    "(Current * Voltage >= 2000 or Fault = 1) and not Msg.Test",
+    std::ref(resolver)));
+  EXPECT_EQ(resolver.Names().size(), 4);
+  EXPECT_EQ(resolver.Names()[3], "Msg.Test");
+
+  std::array<double, 4> values = {10.0, 200.0, 0.0, 0.0};
+  EXPECT_TRUE(expression.IsTrue(values));
+  values[3] = 1.0;
+  EXPECT_FALSE(expression.IsTrue(values));
+  values = {1.0, 1.0, 1.0, 0.0};
+  EXPECT_TRUE(expression.IsTrue(values));
+}
+
+TEST(TestTriggerExpression, TestArithmetic) {
+  Resolver resolver;
+  TriggerExpression expression;
+  EXPECT_TRUE(expression.Compile("-A + 2 * (B - 1) / 4", std::ref(resolver)));
+  const std::array<double, 2> values = {1.0, 5.0};
+  EXPECT_DOUBLE_EQ(expression.Evaluate(values), 1.0);
+
+  EXPECT_TRUE(expression.Compile("A / 0 == 0 && true", std::ref(resolver)));
+  EXPECT_TRUE(expression.IsTrue(values));
+
+  EXPECT_TRUE(expression.Compile("1.5e1 != 15", std::ref(resolver)));
+  EXPECT_FALSE(expression.IsTrue(values));
+}
+
+TEST(TestTriggerExpression, TestErrors) {
+  Resolver resolver;
+  TriggerExpression expression;
+  EXPECT_FALSE(expression.Compile("", std::ref(resolver)));
+  EXPECT_FALSE(expression.Compile("A >", std::ref(resolver)));
+  EXPECT_FALSE(expression.Compile("(A > 1", std::ref(resolver)));
+  EXPECT_FALSE(expression.Compile("A > 1)", std::ref(resolver)));
+  EXPECT_FALSE(expression.Compile("A # 1", std::ref(resolver)));
+  EXPECT_FALSE(expression.Compile("Unknown > 1", std::ref(resolver)));
+  EXPECT_FALSE(expression.LastError().empty());
+  EXPECT_TRUE(expression.IsEmpty());
+
+  std::string deep;
+  for (size_t count = 0; count <= TriggerExpression::kMaxStack; ++count) {
+    deep += "1 + (";
+  }
+  deep += "1";
+  deep += std::string(TriggerExpression::kMaxStack + 1, ')');
+  EXPECT_FALSE(expression.Compile(deep, std::ref(resolver)));
+}
+
+}